@@ -0,0 +1,50 @@
+#ifndef BATTERY_MONITOR_H
+#define BATTERY_MONITOR_H
+
+#include <Arduino.h>
+
+// Интервал между измерениями в зависимости от запаса до порога и скорости разряда
+#define BATTERY_INTERVAL_LONG_MS    300000  // Запас > 300 мВ, напряжение стабильно
+#define BATTERY_INTERVAL_MS         60000   // Запас > 100 мВ
+#define BATTERY_INTERVAL_SHORT_MS   10000   // Близко к порогу или быстрый разряд
+#define BATTERY_CONFIRM_INTERVAL_MS 2000    // Подтверждение напряжения ниже порога
+
+// Число измерений подряд ниже порога для отключения (просадки при передаче не должны отключать узел)
+#define BATTERY_SHUTDOWN_SAMPLES 3
+
+// Аппаратное усреднение АЦП: 16 выборок, сдвиг на 4 бита (результат остается 12-битным)
+#define BATTERY_OVERSAMPLING_RATIO ADC_OVERSAMPLING_RATIO_16
+#define BATTERY_OVERSAMPLING_SHIFT ADC_RIGHTBITSHIFT_4
+
+/**
+ * @brief Однократное измерение напряжения батареи в мВ.
+ *
+ * Аппаратный оверсемплер ADC STM32L0 усредняет 16 выборок за один запуск преобразования.
+ * АЦП включается на время измерения (калибровка + преобразование, сотни мкс) и выключается.
+ */
+uint16_t batteryMeasureMillivolts();
+
+/**
+ * @brief Выполняет плановое измерение и обновляет решение об отключении.
+ *
+ * @param nowMs Текущее время rtcNowMs() (millis() не идет в режиме Stop)
+ * @return интервал до следующего измерения, мс
+ */
+uint32_t batteryMonitorSample(uint32_t nowMs);
+
+/**
+ * @brief Последнее измеренное напряжение в мВ.
+ */
+uint16_t batteryMillivolts();
+
+/**
+ * @brief Последний результат АЦП (после усреднения), для калибровки adc_multiplier.
+ */
+uint16_t batteryRawAdc();
+
+/**
+ * @brief true если BATTERY_SHUTDOWN_SAMPLES измерений подряд ниже battery_threshold.
+ */
+bool batteryShutdownRequired();
+
+#endif // BATTERY_MONITOR_H
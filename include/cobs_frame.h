@@ -0,0 +1,24 @@
+#ifndef COBS_FRAME_H
+#define COBS_FRAME_H
+
+#include <Arduino.h>
+
+// Типы двоичных кадров в UART
+#define FRAME_TYPE_EVENT   0x01
+#define FRAME_TYPE_CAPTURE 0x02
+
+// Максимальный размер данных кадра (заголовок + полезная нагрузка).
+// Самый длинный кадр - захват: CaptureRecord (20 байт) + пакет LoRa (до 255 байт).
+#define FRAME_MAX_DATA 275
+
+/**
+ * @brief Отправляет двоичный кадр в лог: COBS([type][head][tail]) и разделитель 0x00.
+ *
+ * Кадр кодируется прямо в TX-буфер Serial. Место под него резервируется заранее,
+ * поэтому при нехватке места кадр теряется целиком и не рвет поток.
+ *
+ * @return true если кадр поставлен в очередь на отправку
+ */
+bool sendFrame(uint8_t type, const void* head, size_t headLen, const void* tail = NULL, size_t tailLen = 0);
+
+#endif // COBS_FRAME_H
@@ -3,35 +3,83 @@
 
 #include <Arduino.h>
 
-#define CONFIG_MAGIC 0x4B41534B // "KASK" in hex
-#define CONFIG_VERSION 4
+// Карта Data EEPROM (STM32L051: 2 КБ)
+#define EEPROM_CONFIG_ADDR      0    // Журнал конфигурации (CONFIG_LOG_PAGES страниц)
+#define EEPROM_RADIO_IMAGE_ADDR 512  // Образ регистров SX1276 для быстрого старта (64 байта)
+#define EEPROM_CACHE_SNAPSHOT_ADDR 576 // Снимок кэша дубликатов (448 байт)
+#define EEPROM_POLICY_ADDR      1024 // Таблица политик ретрансляции (72 байта)
+#define EEPROM_SCAN_ADDR        1096 // Пресеты сканирования (40 байт)
+
+// Журнал конфигурации: кольцо страниц, в которые дописываются записи измененных полей.
+// Страница: заголовок {pageSeq, CRC-32} и записи {id, len, data[len], CRC-32}.
+// CRC записи включает pageSeq страницы, поэтому остатки предыдущего прохода кольца не читаются.
+#define CONFIG_LOG_PAGES     8
+#define CONFIG_LOG_PAGE_SIZE 64
+#define CONFIG_LOG_MAGIC     0x4B4C4F47 // "KLOG"
 
 struct DeviceConfig {
-    uint32_t magic;
-    uint8_t version;
-    
-    // Radio parameters
-    float radio_frequency;
-    float radio_bandwidth;
+    // Radio parameters (fixed point: no soft-float on Cortex-M0+)
+    uint32_t radio_frequency;      // Hz
+    uint16_t radio_bandwidth;      // 0.1 kHz units (2500 = 250 kHz)
     uint8_t radio_spreadingFactor;
     uint8_t radio_codingRate;
     uint8_t radio_syncWord;
     uint16_t radio_preambleLength;
 
     // Power and ADC parameters
-    float adc_multiplier;
-    float battery_threshold;
+    uint32_t adc_multiplier;       // uV per ADC LSB
+    uint16_t battery_threshold;    // mV
 
     // Security parameters
     uint8_t aes_key[16];
 
     // Logging level: 0 - none, 1 - packets, 2 - insight
     uint8_t log_level;
-    
+
     // Relay delay: -1 = disabled, 0+ = delay in ms (packet is retransmitted without modification) (UART command: dlrl)
     int32_t relay_delay;
-    
-    uint16_t checksum;
+
+    // Binary event stream: 1 = each event is also sent over UART as a COBS frame (UART command: evs)
+    uint8_t event_stream;
+
+    // Raw packet capture: 1 = each received frame is sent over UART with radio metadata (UART command: cap)
+    uint8_t capture_stream;
+
+    // Power tiers: below eco threshold insight logging and telemetry/NODEINFO relays stop,
+    // below critical only direct and wantAck packets are relayed (mV) (UART commands: peco, pcrt, phys)
+    uint16_t power_eco_threshold;
+    uint16_t power_critical_threshold;
+    uint16_t power_hysteresis;
+
+    // Current model for the energy estimate (UART commands: ist, irun, iuar, irx, itx, itxd, bcap)
+    uint16_t current_stop;         // 0.1 uA, MCU in Stop (incl. battery divider)
+    uint16_t current_run;          // uA, MCU running
+    uint16_t current_uart;         // uA, MCU in Sleep while USART drains the log
+    uint16_t current_rx;           // uA, SX1276 listening
+    uint16_t current_tx;           // uA, SX1276 transmitting at 0 dBm
+    uint16_t current_tx_dbm;       // uA added per dBm of TX power
+    uint16_t battery_capacity;     // mAh
+
+    // Next-hop routing: relay directed packets only if nextHop is unset or equals relay_id (0 - no ID).
+    // Otherwise relay as a fallback if the designated hop is not heard within next_hop_timeout ms
+    // (0 - never). (UART commands: rid, nhto)
+    uint8_t relay_id;
+    uint16_t next_hop_timeout;
+
+    // Flood protection: max share of received airtime (%) per sender before its broadcasts
+    // stop being relayed, 0 - disabled (UART command: flsh)
+    uint8_t flood_share;
+
+    // Cycle CAD across the preset list instead of continuous RX on the main preset,
+    // takes effect after reboot (UART command: scen)
+    uint8_t scan_mode;
+
+    // Listen-before-talk: channel is busy above this instantaneous RSSI, dBm (0 - modem status only)
+    // (UART command: lbt)
+    int8_t lbt_rssi;
+
+    // Own TELEMETRY beacon period, minutes (0 - disabled), takes effect after apply (UART command: tlm)
+    uint16_t telemetry_interval;
 };
 
 // Дефолтные значения
@@ -40,8 +88,21 @@ extern const DeviceConfig DEFAULT_CONFIG;
 extern DeviceConfig currentConfig;
 
 // Объявления функций
-uint16_t calculateChecksum(const DeviceConfig& cfg);
+
+/**
+ * @brief Восстанавливает конфигурацию из журнала в EEPROM.
+ *
+ * Поля без записей в журнале получают значения по умолчанию. Записи устаревших
+ * версий представления поля конвертируются. При отсутствии журнала выполняется
+ * миграция из прежнего формата (целая структура v4 по адресу 0).
+ *
+ * @return true если найден журнал или прежний формат
+ */
 bool loadConfig(DeviceConfig& cfg);
+
+/**
+ * @brief Дописывает в журнал только поля, изменившиеся с последнего сохранения.
+ */
 void saveConfig(DeviceConfig& cfg);
 
 #endif // CONFIG_STORAGE_H
@@ -0,0 +1,25 @@
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Продолжает расчет CRC-32 (IEEE 802.3, полином 0xEDB88320).
+ *
+ * Побитовая реализация без таблицы: медленнее табличной, но не тратит 1 КБ Flash.
+ * Для цепочки вызовов передавайте результат предыдущего вызова в crc.
+ *
+ * @param crc Текущее значение (0 для начала расчета)
+ * @param data Данные
+ * @param len Длина данных в байтах
+ */
+uint32_t crc32Update(uint32_t crc, const void* data, size_t len);
+
+/**
+ * @brief CRC-32 блока данных.
+ */
+inline uint32_t crc32(const void* data, size_t len) {
+    return crc32Update(0, data, len);
+}
+
+#endif // CRC32_H
@@ -0,0 +1,51 @@
+#ifndef ENERGY_ACCOUNT_H
+#define ENERGY_ACCOUNT_H
+
+#include <Arduino.h>
+
+// Состояния контроллера. Радио учитывается отдельно: передача, сон после energyRadioSleep()
+// или прием (все остальное время).
+enum McuState : uint8_t {
+    MCU_RUN,    // Выполнение кода
+    MCU_UART,   // Sleep, пока прерывание USART дописывает лог
+    MCU_STOP,   // Stop, время по RTC
+    MCU_STATE_COUNT
+};
+
+/**
+ * @brief Начало учета. Вызывать в setup() после rtcClockInit().
+ */
+void energyInit();
+
+/**
+ * @brief Переход контроллера в другое состояние (кроме Stop).
+ *
+ * Время текущего состояния считается по micros(): SysTick идет в Run и Sleep.
+ */
+void energyMcuState(McuState next);
+
+/**
+ * @brief Вход в Stop и выход из него. В Stop SysTick стоит, поэтому время берется из RTC.
+ */
+void energyStopBegin();
+void energyStopEnd();
+
+/**
+ * @brief Передача LoRa. Вызывать вокруг блокирующего transmit().
+ */
+void energyTxBegin();
+void energyTxEnd();
+
+/**
+ * @brief Радио переведено в Sleep (отключение по разряду батареи). Из сна его выводит
+ * только перезагрузка, поэтому все дальнейшее время учитывается как сон радио, а не прием.
+ */
+void energyRadioSleep();
+
+/**
+ * @brief Время по состояниям, расход по модели токов из конфигурации,
+ * средний ток, расчетное время работы на оставшемся заряде батареи и основной потребитель.
+ */
+void energyPrintReport(Print& out);
+
+#endif // ENERGY_ACCOUNT_H
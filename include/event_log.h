@@ -0,0 +1,60 @@
+#ifndef EVENT_LOG_H
+#define EVENT_LOG_H
+
+#include <Arduino.h>
+#include "mesh_utils.h"
+
+// Размер кольца событий (степень двойки)
+#define EVENT_LOG_SIZE 32
+
+enum EventId : uint8_t {
+    EV_BOOT = 1,      // a: время до входа в прием (мкс), b: 1 - быстрый старт
+    EV_PKT_NEW,       // Новый пакет
+    EV_PKT_DUP,       // Дубликат
+    EV_PKT_SHORT,     // Пакет короче заголовка Meshtastic
+    EV_RX_ERROR,      // a: код ошибки RadioLib
+    EV_RELAY_TX,      // Пакет ретранслирован
+    EV_RELAY_BUSY,    // Ретрансляция пропущена: канал занят
+    EV_BATTERY,       // a: напряжение (мВ), b: результат АЦП
+    EV_SHUTDOWN,      // a: напряжение (мВ)
+    EV_POWER_TIER,    // a: новая ступень энергосбережения, b: напряжение (мВ)
+    EV_RELAY_SKIP,    // Ретрансляция пропущена политикой энергосбережения
+    EV_RELAY_LATENCY, // Следует за EV_RELAY_TX. a: relay_delay (мс) | ожидание канала (мс) << 16,
+                      // b: обработка (мкс) | передача (мс) << 16; значения насыщаются на 0xFFFF
+    EV_RELAY_POLICY,  // Ретрансляция запрещена политикой (relay_policy.h)
+    EV_RELAY_FLOOD,   // Ретрансляция ограничена защитой от заливки (flood_guard.h)
+};
+
+/**
+ * Запись события фиксированного размера. Передается в двоичном потоке как есть (little endian).
+ * Для системных событий from/pktId хранят параметры a/b.
+ */
+struct __attribute__((packed)) EventRecord {
+    uint32_t timestamp;   // rtcStamp(): время суток из регистров RTC
+    uint8_t id;           // EventId
+    uint8_t flags;        // MeshHeader.flags
+    uint8_t chanHash;
+    uint8_t relayNode;
+    uint32_t from;
+    uint32_t pktId;
+    int16_t rssi;         // дБм
+    int8_t snr;           // 0.25 дБ
+    uint8_t len;          // Длина пакета
+};
+
+/**
+ * @brief Записывает событие пакета. Стоит единицы микросекунд: только копирование в кольцо.
+ */
+void eventLogPacket(EventId id, const MeshHeader& header, int16_t rssi, int8_t snrQ4, uint8_t len);
+
+/**
+ * @brief Записывает системное событие с двумя параметрами.
+ */
+void eventLogSystem(EventId id, uint32_t a = 0, uint32_t b = 0);
+
+/**
+ * @brief Форматирует содержимое кольца в текст (UART команда dump).
+ */
+void eventLogDump(Print& out);
+
+#endif // EVENT_LOG_H
@@ -0,0 +1,36 @@
+#ifndef FIXED_POINT_H
+#define FIXED_POINT_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Переводит число IEEE-754 single, заданное битами, в целое value * scale с округлением.
+ *
+ * Только целочисленные операции: используется для float из протоколов Meshtastic
+ * и старых записей конфигурации, чтобы не подключать программную эмуляцию float.
+ * Ноль и денормализованные числа дают 0, переполнение и бесконечность насыщаются.
+ *
+ * @param bits Биты числа (little endian, как в памяти)
+ * @param scale Множитель, например 100 для двух знаков после точки
+ */
+int32_t floatBitsToFixed(uint32_t bits, uint32_t scale);
+
+/**
+ * @brief Обратное преобразование: value / scale в биты IEEE-754 single с округлением мантиссы.
+ *
+ * Нужно для float-полей Protobuf (телеметрия Meshtastic) без программной эмуляции float.
+ *
+ * @param value Число с фиксированной точкой, например милливольты
+ * @param scale Делитель, например 1000 для вольт
+ */
+uint32_t fixedToFloatBits(int32_t value, uint32_t scale);
+
+/**
+ * @brief Разбирает десятичную дробь в целое с decimals знаками после точки
+ * (лишние знаки отбрасываются) либо HEX-число с префиксом 0x.
+ *
+ * @return false если строка не число или не помещается в int32_t
+ */
+bool parseFixed(const char* s, uint8_t decimals, int32_t& out);
+
+#endif // FIXED_POINT_H
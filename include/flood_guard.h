@@ -0,0 +1,46 @@
+#ifndef FLOOD_GUARD_H
+#define FLOOD_GUARD_H
+
+#include <Arduino.h>
+#include "mesh_utils.h"
+
+// Count-min sketch: FLOOD_DEPTH строк по FLOOD_WIDTH счетчиков (мс в эфире)
+#define FLOOD_DEPTH 3
+#define FLOOD_WIDTH_BITS 5
+#define FLOOD_WIDTH (1 << FLOOD_WIDTH_BITS)
+
+// Период затухания: все счетчики делятся пополам. Счетчик отправителя
+// в установившемся режиме - около двух периодов его времени в эфире
+#define FLOOD_DECAY_MS 30000UL
+
+// Пока суммарное время в эфире меньше этого (~5% канала), никто не ограничивается
+#define FLOOD_MIN_TOTAL_MS 3000
+
+// Отправителей в списке кандидатов (UART команда flood)
+#define FLOOD_TOP_N 4
+
+/**
+ * @brief Учитывает время в эфире нового пакета отправителя.
+ *
+ * Счетчики затухают лениво, при следующем обращении, поэтому таймер не нужен
+ * и сон не прерывается.
+ *
+ * @param preset Пресет, на котором принят пакет: по его SF и полосе считается время в эфире
+ */
+void floodAccount(const MeshHeader& header, uint8_t len, uint8_t preset);
+
+/**
+ * @brief Разрешает ли защита от заливки ретрансляцию пакета.
+ *
+ * Ограничиваются только широковещательные пакеты отправителя, чья доля времени
+ * в эфире выше currentConfig.flood_share. Личные сообщения и ACK (ROUTING)
+ * не ограничиваются; порт читается только у кандидата на ограничение.
+ */
+bool floodAllowsRelay(const MeshHeader& header, MeshPortPeek& port);
+
+/**
+ * @brief Самые активные отправители: оценка времени в эфире, доля и число ограниченных пакетов.
+ */
+void floodPrint(Print& out);
+
+#endif // FLOOD_GUARD_H
@@ -0,0 +1,79 @@
+#ifndef LOG_H
+#define LOG_H
+
+#include <Arduino.h>
+#include "config_storage.h"
+
+// Максимальный уровень логирования, попадающий в прошивку (0 - none, 1 - packets, 2 - insight).
+// Вызовы выше него удаляются компилятором вместе со строками F(). Задается в platformio.ini.
+#ifndef LOG_MAX_LEVEL
+#define LOG_MAX_LEVEL 2
+#endif
+
+#define LOG_COMPILED(level) (LOG_MAX_LEVEL >= (level))
+
+// Временное ограничение уровня во время работы (энергосбережение), 0xFF - без ограничения
+extern uint8_t logLevelCap;
+
+/**
+ * @brief Включен ли уровень логирования.
+ *
+ * Уровень выше LOG_MAX_LEVEL отсекается на этапе компиляции, остальные фильтруются
+ * по currentConfig.log_level и logLevelCap во время работы.
+ */
+template <uint8_t Level>
+inline bool logEnabled() {
+    return LOG_COMPILED(Level) && currentConfig.log_level >= Level && logLevelCap >= Level;
+}
+
+/**
+ * Неблокирующий вывод лога в UART.
+ *
+ * Пишет в кольцевой TX-буфер HardwareSerial, который опустошается прерыванием USART
+ * (размер задается SERIAL_TX_BUFFER_SIZE в platformio.ini). Если сообщение целиком
+ * не помещается в буфер, оно отбрасывается и учитывается в счетчике, а не блокирует
+ * RX/relay путь. При появлении места в лог выводится отметка о потерянных байтах.
+ */
+class AsyncLog : public Print {
+public:
+    size_t write(uint8_t c) override;
+    size_t write(const uint8_t* buffer, size_t size) override;
+    using Print::write;
+
+    /**
+     * @brief Резервирует место под сообщение, которое выводится по байту (writeReserved).
+     * @return false если места нет: сообщение учтено как потерянное
+     */
+    bool reserve(size_t size);
+
+    /**
+     * @brief Вывод в место, зарезервированное reserve(): без проверки и отметок о потерях.
+     */
+    void writeReserved(uint8_t c) { Serial.write(c); }
+
+    /**
+     * @brief Есть ли неотправленные байты в буфере.
+     * Пока true, можно спать только в Sleep (USART тактируется), но не в Stop.
+     */
+    bool pending();
+
+    /**
+     * @brief Блокирующее ожидание отправки всего буфера. Вызывать только перед Stop.
+     */
+    void flush() override;
+
+    /**
+     * @brief Общее количество отброшенных байт с момента старта.
+     */
+    uint32_t droppedBytes() const { return dropped; }
+
+private:
+    void reportDropped();
+
+    uint32_t dropped = 0;
+    uint32_t droppedSinceNotice = 0;
+};
+
+extern AsyncLog Log;
+
+#endif // LOG_H
@@ -3,6 +3,13 @@
 
 #include <Arduino.h>
 
+#define MESH_BROADCAST_ADDR 0xFFFFFFFF
+
+// Номера портов Meshtastic (meshtastic.PortNum), используемые в политике ретрансляции
+#define PORTNUM_NODEINFO     4
+#define PORTNUM_ROUTING      5
+#define PORTNUM_TELEMETRY    67
+
 /**
  * Структура заголовка Meshtastic (Layer 1)
  */
@@ -25,6 +32,13 @@ struct MeshHeader {
  */
 void parseMeshHeader(const uint8_t* buffer, MeshHeader* header);
 
+/**
+ * @brief Записывает заголовок в первые 16 байт буфера (обратное parseMeshHeader).
+ *
+ * Флаги собираются из hopLimit, wantAck, viaMqtt и hopStart, поле flags не используется.
+ */
+void writeMeshHeader(uint8_t* buffer, const MeshHeader& header);
+
 /**
  * @brief Инициализирует 128-битный nonce для расшифровки.
  *
@@ -45,6 +59,51 @@ void initMeshtasticNonce(uint8_t *nonce, uint32_t fromNode, uint32_t packetId);
  */
 void decryptMeshtasticPayload(uint8_t* buffer, size_t len, uint32_t fromNode, uint32_t packetId, const uint8_t* key, bool is_be = false);
 
+/**
+ * @brief Шифрует Payload Meshtastic на месте. В режиме CTR это та же операция,
+ * что и расшифровка: XOR с тем же потоком ключа.
+ */
+void encryptMeshtasticPayload(uint8_t* buffer, size_t len, uint32_t fromNode, uint32_t packetId, const uint8_t* key);
+
+/**
+ * @brief Ключ канала по хэшу: базовый PSK с номером канала в последнем байте.
+ *
+ * @param psk Выходной буфер (16 байт)
+ */
+void meshChannelKey(const MeshHeader& header, const uint8_t* baseKey, uint8_t* psk);
+
+/**
+ * @brief Номер порта пакета без полной расшифровки.
+ *
+ * Расшифровывает только первый блок AES (16 байт) во временный буфер:
+ * portnum - первое поле meshtastic.Data.
+ *
+ * @param buffer Сырой пакет (с заголовком)
+ * @return номер порта или -1, если его не удалось прочитать (другой ключ, нет данных)
+ */
+int16_t meshPeekPortnum(const uint8_t* buffer, size_t len, const MeshHeader& header, const uint8_t* baseKey);
+
+#define MESH_PORT_NOT_READ (-2)
+
+/**
+ * Порт принятого пакета, общий для фильтров ретрансляции. handlePacket() заводит
+ * его на пакет; первый фильтр, которому нужен порт, расшифровывает блок, остальные
+ * берут сохраненное значение. Если порт не понадобился, расшифровки нет.
+ */
+struct MeshPortPeek {
+    const uint8_t* buffer;  // Сырой пакет (с заголовком)
+    size_t len;
+    const MeshHeader& header;
+    const uint8_t* baseKey;
+    int16_t port;           // MESH_PORT_NOT_READ до первого meshPort()
+};
+
+/**
+ * @brief Номер порта пакета: при первом вызове meshPeekPortnum(), дальше сохраненное значение.
+ * @return номер порта или -1, если его не удалось прочитать
+ */
+int16_t meshPort(MeshPortPeek& peek);
+
 /**
  * @brief Читает Protobuf Varint и сдвигает указатель.
  */
@@ -55,4 +114,40 @@ uint32_t pbReadVarint(uint8_t** ptr, size_t* rem);
  */
 void pbSkipField(uint8_t wireType, uint8_t** ptr, size_t* rem);
 
+/**
+ * Запись Protobuf прямо в буфер пакета, без промежуточных структур.
+ * Функции сдвигают указатель и уменьшают остаток; при нехватке места
+ * ничего не пишут и возвращают false.
+ */
+
+/**
+ * @brief Пишет Protobuf Varint.
+ */
+bool pbWriteVarint(uint8_t** ptr, size_t* rem, uint32_t value);
+
+/**
+ * @brief Пишет поле varint (uint32, enum, bool): тег и значение.
+ */
+bool pbWriteUint(uint8_t** ptr, size_t* rem, uint8_t field, uint32_t value);
+
+/**
+ * @brief Пишет поле fixed32 (fixed32, float по битам из fixedToFloatBits()).
+ */
+bool pbWriteFixed32(uint8_t** ptr, size_t* rem, uint8_t field, uint32_t value);
+
+/**
+ * @brief Открывает вложенное сообщение или поле bytes: пишет тег и резервирует
+ * один байт длины. Содержимое пишется следом обычными функциями.
+ *
+ * @return позиция байта длины для pbEndNested() или NULL при нехватке места
+ */
+uint8_t* pbBeginNested(uint8_t** ptr, size_t* rem, uint8_t field);
+
+/**
+ * @brief Закрывает вложенное сообщение: записывает длину от lenPos до ptr.
+ *
+ * @return false если lenPos == NULL или длина не помещается в один байт (больше 127)
+ */
+bool pbEndNested(uint8_t* lenPos, const uint8_t* ptr);
+
 #endif // MESH_UTILS_H
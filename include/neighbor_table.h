@@ -0,0 +1,50 @@
+#ifndef NEIGHBOR_TABLE_H
+#define NEIGHBOR_TABLE_H
+
+#include <Arduino.h>
+#include "mesh_utils.h"
+
+// Размер таблицы (записи выделяются статически)
+#define NEIGHBOR_MAX 16
+
+// Запись старше этого считается устаревшей: не находится поиском и вытесняется первой
+#define NEIGHBOR_MAX_AGE_MS (2UL * 60 * 60 * 1000)
+
+// Вес нового измерения в скользящем среднем: 1/2^NEIGHBOR_EWMA_SHIFT
+#define NEIGHBOR_EWMA_SHIFT 3
+
+#define NEIGHBOR_HOPS_UNKNOWN 0xFF
+
+/**
+ * Связь "отправитель через последний ретранслятор". Прямой сосед - запись с hops == 0.
+ */
+struct Neighbor {
+    uint32_t from;          // Отправитель (0 - свободная запись)
+    uint32_t lastHeardMs;   // rtcNowMs()
+    int16_t rssi;           // EWMA, 1/16 дБм
+    int16_t snr;            // EWMA, 1/16 дБ
+    uint16_t count;         // Принятых кадров (насыщается)
+    uint8_t relay;          // MeshHeader.relayNode: младший байт ID последнего ретранслятора
+    uint8_t hops;           // hopStart - hopLimit или NEIGHBOR_HOPS_UNKNOWN
+};
+
+/**
+ * @brief Учитывает принятый кадр, в том числе дубликат: он показывает еще одну связь.
+ *
+ * Новая связь занимает свободную, устаревшую или самую давно слышанную запись.
+ */
+void neighborUpdate(const MeshHeader& header, int16_t rssi, int8_t snrQ4);
+
+/**
+ * @brief Самая свежая связь через ретранслятор relay, то есть качество приема от него самого.
+ * Ретрансляция по ней узнает, слышен ли назначенный next hop.
+ * @return запись или NULL
+ */
+const Neighbor* neighborByRelay(uint8_t relay);
+
+/**
+ * @brief Таблица связей (UART команда nb).
+ */
+void neighborPrint(Print& out);
+
+#endif // NEIGHBOR_TABLE_H
@@ -3,6 +3,9 @@
 
 #include <Arduino.h>
 
+// Количество последних записей, переживающих перезагрузку
+#define PACKET_CACHE_SNAPSHOT_SLOTS 48
+
 /**
  * Структура для хранения идентификаторов пакета
  */
@@ -12,8 +15,9 @@ struct PacketId {
 };
 
 /**
- * Инициализирует кольцевой буфер.
- * Пытается выделить максимально возможный объем RAM.
+ * Инициализирует кольцевой буфер в области ARENA_CACHE (вызывать после arenaInit()).
+ * Число слотов определяется остатком RAM после сборки.
+ * Восстанавливает записи из снимка в EEPROM, если он цел.
  */
 void packetCacheInit();
 
@@ -34,4 +38,17 @@ bool addPacketToCache(uint32_t senderId, uint32_t pktId);
  */
 size_t getPacketCacheSize();
 
+/**
+ * Возвращает число слотов, выделенных под кэш.
+ */
+size_t getPacketCacheCapacity();
+
+/**
+ * Сохраняет последние PACKET_CACHE_SNAPSHOT_SLOTS записей в EEPROM.
+ * Вызывается перед контролируемой перезагрузкой или отключением по батарее.
+ * Записи лежат в EEPROM по номеру вставки, поэтому переписываются только новые
+ * записи и заголовок; без новых записей с прошлого снимка EEPROM не трогается.
+ */
+void packetCacheSave();
+
 #endif // PACKET_CACHE_H
@@ -0,0 +1,46 @@
+#ifndef PACKET_CAPTURE_H
+#define PACKET_CAPTURE_H
+
+#include <Arduino.h>
+
+// Решение ретранслятора по принятому кадру
+enum CaptureVerdict : uint8_t {
+    CAP_NEW = 0,      // Новый пакет, не ретранслировался (dlrl=-1)
+    CAP_DUP,          // Дубликат по кэшу
+    CAP_SHORT,        // Короче заголовка Meshtastic
+    CAP_CRC_ERROR,    // Ошибка CRC LoRa, данные как есть
+    CAP_RELAYED,      // Новый пакет, поставлен в очередь на ретрансляцию
+    CAP_BUSY,         // Новый пакет, ретрансляция пропущена: слот занят
+    CAP_POWER_SKIP,   // Новый пакет, ретрансляция отключена политикой энергосбережения
+    CAP_NEXT_HOP,     // Назначен другой next hop: ждем его повтора, ретранслируем только по таймауту
+    CAP_POLICY_DROP,  // Новый пакет, ретрансляция запрещена политикой (drop или превышен rate)
+    CAP_FLOOD,        // Новый пакет, отправитель превысил долю эфира flood_share
+};
+
+/**
+ * Метаданные кадра захвата. В потоке за ними следуют сырые байты пакета.
+ * Передается как есть (little endian).
+ */
+struct __attribute__((packed)) CaptureRecord {
+    uint32_t timestamp;   // rtcStamp(), как в EventRecord: кадр сопоставляется с событиями пакета
+    int32_t freqError;    // Гц
+    uint32_t frequency;   // Гц, пресет приема
+    uint16_t bandwidth;   // 0.1 кГц, пресет приема
+    int16_t rssi;         // дБм
+    int8_t snr;           // 0.25 дБ
+    uint8_t verdict;      // CaptureVerdict
+    uint8_t preset;       // Индекс пресета приема (0 - основной)
+    uint8_t sf;           // SF пресета приема
+};
+
+/**
+ * @brief Отправляет сырой кадр с метаданными в UART (кадр FRAME_TYPE_CAPTURE), если включен cap=1.
+ *
+ * При 57600 бод кадр максимальной длины уходит за ~49 мс, что меньше времени
+ * в эфире самого короткого пакета Meshtastic на SF11.
+ *
+ * @param preset Пресет, на котором принят кадр: его частота, полоса и SF идут в запись
+ */
+void captureFrame(const uint8_t* data, uint8_t len, uint8_t preset, int16_t rssi, int8_t snrQ4, int32_t freqError, CaptureVerdict verdict);
+
+#endif // PACKET_CAPTURE_H
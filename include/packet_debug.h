@@ -4,6 +4,8 @@
 #include <Arduino.h>
 #include <RadioLib.h>
 #include "mesh_utils.h"
+#include "sx1276_regs.h"
+#include "log.h"
 
 /**
  * @brief Выводит подробную информацию о пакете Meshtastic в консоль.
@@ -13,7 +15,7 @@
  * @param radio Ссылка на объект радио для получения RSSI/SNR/FreqError
  * @param header Распарсенный заголовок пакета (должен быть заполнен)
  */
-void printPacketInsight(uint8_t* buffer, size_t len, SX1276& radio, const MeshHeader& header);
+void printPacketInsight(uint8_t* buffer, size_t len, KaskaSX1276& radio, const MeshHeader& header);
 
 /**
  * @brief Печатает число с фиксированной точкой без использования float в Serial.print.
@@ -21,7 +23,8 @@ void printPacketInsight(uint8_t* buffer, size_t len, SX1276& radio, const MeshHe
  * @param value Значение в виде целого числа (scaled).
  * @param divisor Делитель для получения целой части (например, 10000000 для координат).
  * @param precision Количество знаков после запятой для вывода дробной части.
+ * @param out Куда печатать (по умолчанию неблокирующий лог).
  */
-void printFixedPoint(int32_t value, int32_t divisor, int8_t precision);
+void printFixedPoint(int32_t value, int32_t divisor, int8_t precision, Print& out = Log);
 
 #endif // PACKET_DEBUG_H
@@ -0,0 +1,40 @@
+#ifndef POWER_POLICY_H
+#define POWER_POLICY_H
+
+#include <Arduino.h>
+#include "mesh_utils.h"
+
+/**
+ * Ступени энергосбережения по мере разряда батареи. Ниже battery_threshold
+ * узел отключается полностью (см. batteryShutdownRequired()).
+ */
+enum PowerTier : uint8_t {
+    PWR_FULL = 0,     // Все функции
+    PWR_ECO,          // Лог не выше log=1, телеметрия и NODEINFO не ретранслируются
+    PWR_CRITICAL,     // Ретранслируются только личные сообщения и пакеты с wantAck
+};
+
+/**
+ * @brief Пересчитывает ступень по напряжению с учетом гистерезиса.
+ *
+ * Вниз ступень переключается при напряжении ниже порога, вверх - только когда
+ * напряжение превысит порог на power_hysteresis.
+ *
+ * @return true если ступень изменилась
+ */
+bool powerPolicyUpdate(uint16_t millivolts);
+
+/**
+ * @brief Текущая ступень.
+ */
+PowerTier powerTier();
+
+/**
+ * @brief Разрешает ли текущая ступень ретрансляцию пакета.
+ *
+ * На ступени PWR_ECO для проверки порта расшифровывается один блок AES.
+ * Пакеты, порт которых прочитать не удалось, ретранслируются.
+ */
+bool powerAllowsRelay(const MeshHeader& header, MeshPortPeek& port);
+
+#endif // POWER_POLICY_H
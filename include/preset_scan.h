@@ -0,0 +1,109 @@
+#ifndef PRESET_SCAN_H
+#define PRESET_SCAN_H
+
+#include <Arduino.h>
+#include "sx1276_regs.h"
+#include "task_scheduler.h"
+
+// Пресетов в списке сканирования, включая основной (0 - из конфигурации радио)
+#define SCAN_MAX_PRESETS 4
+
+// Символов преамбулы, которые должны остаться после CAD, чтобы приемник успел
+// захватить пакет: CAD занимает ~2 символа, синхронизация еще ~5
+#define SCAN_CAD_SYMBOLS  2
+#define SCAN_LOCK_SYMBOLS 5
+
+#define SCAN_BRIDGE_SAME 0xFF  // Ретранслировать на том же пресете
+
+/**
+ * Пресет сканирования. Хранится в EEPROM как есть.
+ */
+struct ScanPreset {
+    uint32_t frequency;   // Гц, 0 - пустая запись
+    uint16_t bandwidth;   // 0.1 кГц, как radio_bandwidth
+    uint8_t sf;
+    uint8_t bridge;       // Индекс пресета для ретрансляции принятых кадров или SCAN_BRIDGE_SAME
+};
+
+enum ScanEvent : uint8_t {
+    SCAN_IDLE,            // Событие обработано внутри (CAD, таймаут), пакета нет
+    SCAN_PACKET,          // Принят пакет: читать его как обычно, затем scanResume()
+};
+
+/**
+ * @brief Загружает список пресетов и, если scan_mode включен и пресетов больше одного,
+ * запускает цикл CAD вместо непрерывного приема. Вызывать после настройки радио и relayInit().
+ *
+ * @param rxTask Задача приема: ее будит таймер ожидания заголовка
+ */
+void scanInit(KaskaSX1276& radio, TaskId rxTask);
+
+/**
+ * @brief Сохраняет список пресетов в EEPROM (вызывается командой apply).
+ */
+void scanSave();
+
+/**
+ * @brief Идет ли сканирование. Без него радио непрерывно принимает на основном пресете.
+ */
+bool scanActive();
+
+/**
+ * @brief Обрабатывает DIO0 или таймер приема: CAD Done переключает на следующий
+ * пресет, а при обнаружении преамбулы фиксирует пресет и включает прием.
+ *
+ * Если заголовок не пришел за время преамбулы, обнаружение считается ложным
+ * и сканирование продолжается.
+ */
+ScanEvent scanPoll();
+
+/**
+ * @brief Возобновляет сканирование со следующего пресета после приема пакета или передачи.
+ */
+void scanResume();
+
+/**
+ * @brief Радио зафиксировано на пресете и принимает пакет: передавать сейчас нельзя.
+ */
+bool scanLocked();
+
+/**
+ * @brief Пресет, на котором принят последний пакет (0 без сканирования).
+ */
+uint8_t scanRxPreset();
+
+/**
+ * @brief Пресет для ретрансляции кадра, принятого на пресете rx.
+ */
+uint8_t scanBridgeTarget(uint8_t rx);
+
+/**
+ * @brief Частота, полоса и SF пресета (0 - основной, всегда из конфигурации радио).
+ */
+const ScanPreset& scanPreset(uint8_t preset);
+
+/**
+ * @brief Время в эфире кадра длины len на пресете, мкс.
+ */
+uint32_t scanTimeOnAirUs(uint8_t preset, uint8_t len);
+
+/**
+ * @brief Переводит радио в Standby и перестраивает на пресет (перед CAD и передачей).
+ */
+void scanTune(uint8_t preset);
+
+/**
+ * @brief Задает или удаляет пресет (UART: scan=<n>,<МГц>,<sf>,<кГц>[,<мост>], scan=<n>,-,
+ * для основного пресета только scan=0,<мост>). Мост '-' - ретранслировать на том же пресете.
+ *
+ * @return false при ошибке разбора
+ */
+bool scanSet(const char* spec);
+
+/**
+ * @brief Пресеты со счетчиками CAD, обнаружений, принятых пакетов, ложных срабатываний
+ * и оценкой доли пропущенных преамбул (UART команда scan).
+ */
+void scanPrint(Print& out);
+
+#endif // PRESET_SCAN_H
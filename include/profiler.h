@@ -0,0 +1,70 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <Arduino.h>
+
+/**
+ * Профилировщик участков горячего пути (сборка с -D ENABLE_PROFILER, env:lora-kaska-prof).
+ *
+ * У Cortex-M0+ нет счетчика тактов DWT, поэтому время берется из свободно бегущего
+ * таймера TIM22 на частоте ядра. Он 16-битный: участки длиннее ~1 мс досчитываются
+ * по micros(). Без ENABLE_PROFILER макросы раскрываются в пустые операторы.
+ */
+
+enum ProfStage : uint8_t {
+    PROF_AWAKE,     // От пробуждения до возврата в Stop
+    PROF_READ,      // readData по SPI
+    PROF_PARSE,     // parseMeshHeader
+    PROF_CACHE,     // Поиск и вставка в кэш дубликатов
+    PROF_DECRYPT,   // AES-CTR
+    PROF_PROTOBUF,  // Разбор meshtastic.Data (вместе с выводом полей)
+    PROF_SERIAL,    // Вывод пакета в UART: insight и кадр захвата
+    PROF_CAD,       // Проверка канала перед ретрансляцией
+    PROF_TX,        // Передача
+    PROF_STAGE_COUNT
+};
+
+// Гистограмма по log2 мкс: корзина 0 - меньше 1 мкс, корзина k - [2^(k-1), 2^k) мкс
+#define PROF_HIST_BUCKETS 20
+
+#ifdef ENABLE_PROFILER
+
+/**
+ * @brief Запускает таймер. Вызывать в setup().
+ */
+void profInit();
+
+void profStart(ProfStage stage);
+void profStop(ProfStage stage);
+
+/**
+ * @brief Таблица min/avg/max и гистограммы по участкам.
+ */
+void profPrint(Print& out);
+
+/**
+ * Измеряет участок до конца области видимости.
+ */
+class ProfScope {
+public:
+    explicit ProfScope(ProfStage stage) : stage(stage) { profStart(stage); }
+    ~ProfScope() { profStop(stage); }
+private:
+    ProfStage stage;
+};
+
+#define PROF_INIT()         profInit()
+#define PROF_START(stage)   profStart(stage)
+#define PROF_STOP(stage)    profStop(stage)
+#define PROF_SCOPE(stage)   ProfScope profScope_##stage(stage)
+
+#else
+
+#define PROF_INIT()         do {} while (0)
+#define PROF_START(stage)   do {} while (0)
+#define PROF_STOP(stage)    do {} while (0)
+#define PROF_SCOPE(stage)   do {} while (0)
+
+#endif // ENABLE_PROFILER
+
+#endif // PROFILER_H
@@ -0,0 +1,55 @@
+#ifndef RAM_ARENA_H
+#define RAM_ARENA_H
+
+#include <Arduino.h>
+
+// Фиксированные области арены в порядке размещения, байт (кратно 8)
+#define ARENA_RX_SIZE      256  // Принятый кадр (handlePacket)
+#define ARENA_TX_SIZE      256  // Кадр в слоте ретрансляции
+#define ARENA_SCRATCH_SIZE 256  // Расшифрованная нагрузка для printPacketInsight
+
+// Куча под арену не отдается целиком: RadioLib выделяет new[] на время каждого
+// SPI-обмена два буфера длиной с кадр (readData 255 байт) плюс заголовки блоков newlib
+#define ARENA_HEAP_RESERVE 576
+
+// Граница между ареной и стеком помечается этим словом; при его порче стек переполнялся
+#define ARENA_GUARD_WORD  0x5AFEA7E5
+// Байт-заполнитель свободного стека для оценки его максимальной глубины
+#define ARENA_STACK_FILL  0xA5
+
+/**
+ * Области арены. Все, кроме кэша, имеют фиксированный размер;
+ * кэш пакетов получает остаток RAM до резерва стека.
+ */
+enum ArenaRegion : uint8_t {
+    ARENA_RX,
+    ARENA_TX,
+    ARENA_SCRATCH,
+    ARENA_CACHE,
+    ARENA_REGION_COUNT
+};
+
+/**
+ * @brief Размечает RAM между концом .bss (_end) и резервом стека (_estack - _Min_Stack_Size):
+ * куча RadioLib, затем области в порядке ArenaRegion. Обнуляет арену и заполняет свободный стек.
+ *
+ * Вызывается первым в setup(), до инициализации модулей, которые берут свои области.
+ */
+void arenaInit();
+
+/**
+ * @brief Начало области (выровнено на 8 байт).
+ */
+uint8_t* arenaRegion(ArenaRegion region);
+
+/**
+ * @brief Размер области в байтах.
+ */
+size_t arenaRegionSize(ArenaRegion region);
+
+/**
+ * @brief Разметка RAM с долей каждой области, пик кучи и максимальная глубина стека (UART команда mem).
+ */
+void arenaPrint(Print& out);
+
+#endif // RAM_ARENA_H
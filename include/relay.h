@@ -0,0 +1,83 @@
+#ifndef RELAY_H
+#define RELAY_H
+
+#include <Arduino.h>
+#include "sx1276_regs.h"
+#include "mesh_utils.h"
+
+// Listen-before-talk: перед передачей канал должен молчать случайную паузу
+// из 1..RELAY_LBT_SLOTS слотов по RELAY_LBT_SLOT_SYMBOLS символов
+#define RELAY_LBT_SLOTS        8
+#define RELAY_LBT_SLOT_SYMBOLS 2
+#define RELAY_LBT_MAX_WAIT_MS  3000  // Отказ, если канал так и не освободился
+
+// Гистограммы задержки: корзина 0 - меньше 1 мкс, корзина k - [2^(k-1), 2^k) мкс, последняя - от ~4 с
+#define RELAY_LAT_BUCKETS    24
+
+/**
+ * @brief Регистрирует таймер и задачу ретрансляции. Вызывать в setup() после входа радио
+ * в прием и до scanInit(): зерно случайных отсрочек берется из шума приемника.
+ */
+void relayInit(KaskaSX1276& radio);
+
+enum RelayResult : uint8_t {
+    RELAY_QUEUED,       // Ретрансляция через relay_delay
+    RELAY_FALLBACK,     // Назначен другой next hop: запасной повтор, если он не повторит сам
+    RELAY_SUPPRESSED,   // Назначен другой next hop, запасной повтор отключен (nhto=0)
+    RELAY_SLOT_BUSY,    // Слот занят предыдущим пакетом
+};
+
+/**
+ * @brief Ставит пакет в очередь на ретрансляцию.
+ *
+ * Пакет копируется, ожидание идет по таймеру RTC: контроллер спит в Stop,
+ * а радио продолжает прием. Если в заголовке назначен next hop и это не мы
+ * (relay_id), пакет ждет next_hop_timeout и отменяется, когда назначенный узел
+ * его повторит (relayHeardRetransmission). Если назначенного узла нет в таблице
+ * связей (neighborByRelay), ожидание сокращается до relay_delay. Обычная
+ * ретрансляция вытесняет такой запасной пакет из слота.
+ *
+ * @param rxDoneUs micros() в прерывании DIO0 (RX-done), начало отсчета задержки
+ * @param extraDelayMs Добавка к задержке от политики ретрансляции (POLICY_DELAY)
+ */
+RelayResult relaySchedule(const uint8_t* buffer, uint8_t len, const MeshHeader& header, int16_t rssi, int8_t snrQ4,
+                          uint32_t rxDoneUs, uint16_t extraDelayMs);
+
+/**
+ * @brief Слот передачи для собственного пакета: пакет собирается прямо в нем.
+ *
+ * @return буфер на 255 байт или NULL, если слот занят ретрансляцией
+ */
+uint8_t* relayTxBuffer();
+
+/**
+ * @brief Отправляет собственный пакет, собранный в relayTxBuffer(), через тот же
+ * listen-before-talk и учет времени в эфире, что и ретрансляцию (на основном пресете).
+ */
+void relayQueueOwn(uint8_t len, const MeshHeader& header);
+
+/**
+ * @brief Сообщает о принятом кадре: канал был занят, отсрочка перед передачей начинается заново.
+ */
+void relayChannelActivity();
+
+/**
+ * @brief Учитывает принятый дубликат: если его повторил назначенный next hop
+ * ожидающего пакета, запасная ретрансляция отменяется.
+ */
+void relayHeardRetransmission(const MeshHeader& header);
+
+/**
+ * @brief Ожидает ли пакет ретрансляции.
+ */
+bool relayPending();
+
+/**
+ * @brief Гистограммы задержки ретрансляции по составляющим: обработка, relay_delay,
+ * ожидание канала, передача и полная задержка RX-done -> TX-done.
+ */
+void relayLatencyPrint(Print& out);
+
+void relayLatencyReset();
+
+#endif // RELAY_H
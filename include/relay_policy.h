@@ -0,0 +1,80 @@
+#ifndef RELAY_POLICY_H
+#define RELAY_POLICY_H
+
+#include <Arduino.h>
+#include "mesh_utils.h"
+
+// Число правил. Таблица целиком хранится в EEPROM (EEPROM_POLICY_ADDR)
+#define POLICY_MAX_RULES 8
+
+// Условие по каналу и источнику (PolicyRule.match)
+#define POLICY_MATCH_ANY_CHAN 0x01  // chanHash не проверяется
+#define POLICY_MATCH_MQTT     0x02  // Только пакеты с флагом viaMqtt
+
+// Специальные значения PolicyRule.port
+#define POLICY_PORT_ANY       0xFFFF  // Порт не проверяется, расшифровка не нужна
+#define POLICY_PORT_UNKNOWN   0xFFFE  // Порт не прочитан: чужой ключ канала или нет данных
+
+// Окно ограничения частоты для POLICY_RATE
+#define POLICY_RATE_WINDOW_MS 60000UL
+
+enum PolicyAction : uint8_t {
+    POLICY_NONE = 0,  // Пустое правило
+    POLICY_RELAY,     // Ретранслировать как обычно
+    POLICY_DROP,      // Не ретранслировать
+    POLICY_DELAY,     // Ретранслировать с дополнительной задержкой param мс
+    POLICY_RATE,      // Ретранслировать не больше param пакетов в минуту
+};
+
+/**
+ * Правило политики ретрансляции. Хранится в EEPROM как есть.
+ */
+struct PolicyRule {
+    uint8_t action;     // PolicyAction
+    uint8_t match;      // POLICY_MATCH_*
+    uint8_t chanHash;
+    uint8_t reserved;
+    uint16_t port;      // meshtastic.PortNum или POLICY_PORT_*
+    uint16_t param;     // POLICY_DELAY: мс, POLICY_RATE: пакетов в минуту
+};
+
+/**
+ * @brief Загружает таблицу из EEPROM. Без сохраненной таблицы все пакеты ретранслируются.
+ */
+void policyInit();
+
+/**
+ * @brief Сохраняет таблицу в EEPROM (вызывается командой apply).
+ */
+void policySave();
+
+/**
+ * @brief Применяет к новому пакету первое подходящее правило.
+ *
+ * Правила проверяются по порядку. Порт читается (meshPort) только если до правила
+ * с условием по порту дошла очередь.
+ * Без подходящего правила пакет ретранслируется.
+ *
+ * @param port Порт пакета, общий с остальными фильтрами ретрансляции
+ * @param extraDelayMs Дополнительная задержка ретрансляции (POLICY_DELAY), иначе 0
+ * @return false если пакет не ретранслируется (POLICY_DROP или превышен POLICY_RATE)
+ */
+bool policyAllowsRelay(const MeshHeader& header, MeshPortPeek& port, uint16_t& extraDelayMs);
+
+/**
+ * @brief Задает или удаляет правило (UART: pol=<n>,<chan>,<port>,<action>[,<param>] или pol=<n>,-).
+ *
+ * chan - HEX хэш канала или '*', с суффиксом 'm' - только пакеты из MQTT;
+ * port - номер порта, '*' - любой, '?' - не удалось прочитать;
+ * action - relay, drop, delay, rate.
+ *
+ * @return false при ошибке разбора
+ */
+bool policySet(const char* spec);
+
+/**
+ * @brief Таблица правил со счетчиками срабатываний (UART команда pol).
+ */
+void policyPrint(Print& out);
+
+#endif // RELAY_POLICY_H
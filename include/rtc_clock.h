@@ -0,0 +1,34 @@
+#ifndef RTC_CLOCK_H
+#define RTC_CLOCK_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Запускает RTC, если его еще не настроила библиотека LowPower.
+ */
+void rtcClockInit();
+
+/**
+ * @brief Время в миллисекундах по RTC.
+ *
+ * В отличие от millis() продолжает идти в Stop mode (SysTick там остановлен).
+ * Переполняется раз в ~49 суток, поэтому сравнивать только разностью.
+ */
+uint32_t rtcNowMs();
+
+/**
+ * @brief Метка времени для журналов: время суток прямо из регистров RTC.
+ *
+ * rtcNowMs() переводит календарь в эпоху через mktime; здесь только чтение
+ * SSR и TR. Биты 31..10 - TR (часы, минуты, секунды в BCD, 24-часовой формат),
+ * биты 9..0 - доля секунды в 1/1024. В миллисекунды переводит rtcStampToMs()
+ * при выводе. Сбрасывается в полночь.
+ */
+uint32_t rtcStamp();
+
+/**
+ * @brief Миллисекунды от начала суток для метки rtcStamp().
+ */
+uint32_t rtcStampToMs(uint32_t stamp);
+
+#endif // RTC_CLOCK_H
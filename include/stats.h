@@ -0,0 +1,64 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <Arduino.h>
+
+/**
+ * Счетчики работы ретранслятора. Обнуляются при старте и командой stats=0.
+ */
+struct RuntimeStats {
+    // Прием
+    uint32_t rxFrames;          // Все кадры, прочитанные из радио
+    uint32_t rxCrcErrors;       // Ошибка CRC
+    uint32_t rxErrors;          // Прочие ошибки чтения (заголовок, длина)
+    uint32_t rxShort;           // Короче заголовка Meshtastic
+    uint32_t rxNew;
+    uint32_t rxDup;
+
+    // Ретрансляция
+    uint32_t relayed;
+    uint32_t relaySlotBusy;     // Отброшен: предыдущий пакет еще ждет отправки
+    uint32_t relayChannelBusy;  // Отброшен: канал не освободился за RELAY_LBT_MAX_WAIT_MS
+    uint32_t relayPowerSkip;    // Отброшен политикой питания
+    uint32_t relayPolicyDrop;   // Отброшен таблицей политик (drop или rate)
+    uint32_t relayFlood;        // Отброшен защитой от заливки
+    uint32_t nextHopHeard;      // Назначенный next hop повторил пакет, наш запасной повтор отменен
+    uint32_t nextHopFallback;   // Next hop не слышен, пакет ретранслирован по таймауту
+    uint32_t cadAttempts;       // Проверки канала перед передачей
+    uint32_t cadBusy;
+    uint32_t lbtRestart;        // Отсрочка начата заново: за нее принят кадр
+    uint32_t txAirtimeMs;
+    uint32_t rxAirtimeMs;       // Расчетное время в эфире принятых кадров
+    uint32_t telemetrySent;     // Отправлено собственных пакетов телеметрии
+
+    // Причины пробуждения из Stop
+    uint32_t wakeDio0;
+    uint32_t wakeUart;
+    uint32_t wakeTimer;
+
+    // Кэш дубликатов
+    uint32_t cacheEvictions;
+    uint32_t evictAgeLastS;     // Возраст вытесненной записи, с
+    uint32_t evictAgeMinS;      // Наименьший возраст (UINT32_MAX - вытеснений с известным возрастом не было)
+};
+
+extern RuntimeStats runtimeStats;
+
+#define STAT_INC(counter) (runtimeStats.counter++)
+
+/**
+ * @brief Обнуляет все счетчики.
+ */
+void statsReset();
+
+/**
+ * @brief Учитывает возраст вытесненной записи кэша.
+ */
+void statsEviction(uint32_t ageMs);
+
+/**
+ * @brief Все счетчики одной строкой key=value через ';', плюс заполнение кэша.
+ */
+void statsPrint(Print& out);
+
+#endif // STATS_H
@@ -0,0 +1,166 @@
+#ifndef SX1276_REGS_H
+#define SX1276_REGS_H
+
+#include <Arduino.h>
+#include <RadioLib.h>
+#include "config_storage.h"
+
+// Регистры SX1276 (LoRa mode), к которым обращаемся напрямую в обход RadioLib
+#define SX1276_REG_OP_MODE      0x01
+#define SX1276_REG_FRF_MSB      0x06
+#define SX1276_REG_IRQ_FLAGS    0x12
+#define SX1276_REG_MODEM_STAT   0x18
+#define SX1276_REG_PKT_SNR      0x19
+#define SX1276_REG_PKT_RSSI     0x1A
+#define SX1276_REG_RSSI_VALUE   0x1B
+#define SX1276_REG_MODEM_CONFIG1 0x1D
+#define SX1276_REG_MODEM_CONFIG2 0x1E
+#define SX1276_REG_MODEM_CONFIG3 0x26
+#define SX1276_REG_FEI_MSB      0x28
+#define SX1276_REG_RSSI_WIDEBAND 0x2C
+#define SX1276_REG_PA_DAC       0x4D
+#define SX1276_REG_VERSION      0x42
+
+// RegFrfMsb от этого значения (~780 МГц) и выше - HF-порт, ниже - LF-порт
+#define SX1276_FRF_MSB_HF       0xC3
+
+#define SX1276_OP_LORA          0x80
+#define SX1276_OP_SLEEP         0x00
+#define SX1276_OP_STDBY         0x01
+
+// RegIrqFlags
+#define SX1276_IRQ_RX_DONE      0x40
+#define SX1276_IRQ_VALID_HEADER 0x10
+#define SX1276_IRQ_CAD_DONE     0x04
+#define SX1276_IRQ_CAD_DETECTED 0x01
+
+// RegModemStat: преамбула обнаружена, модем синхронизирован, заголовок принят
+#define SX1276_MODEM_STAT_BUSY  0x0B
+
+// RegModemConfig3: LowDataRateOptimize
+#define SX1276_MC3_LDRO         0x08
+
+#define SX1276_CHIP_VERSION     0x12
+
+// Мощность передачи: не настраивается, действует значение RadioLib begin() по умолчанию
+#define RADIO_TX_POWER_DBM      10
+
+// Диапазоны регистров, входящие в образ.
+// 0x06..0x0F: Frf, PA, OCP, LNA, указатели FIFO
+// 0x1D..0x3F: ModemConfig1..3, преамбула, sync word, detection optimize.
+// Регистры только для чтения внутри диапазона при записи чип игнорирует.
+#define SX1276_IMG_LO_ADDR      0x06
+#define SX1276_IMG_LO_LEN       10
+#define SX1276_IMG_MODEM_ADDR   0x1D
+#define SX1276_IMG_MODEM_LEN    35
+
+#define RADIO_IMAGE_MAGIC 0x52584D47 // "RXMG"
+
+/**
+ * Снимок регистров SX1276, сохраняемый в EEPROM после полной инициализации.
+ */
+struct RadioImage {
+    uint32_t magic;
+    uint32_t configCrc;   // Отпечаток радиопараметров DeviceConfig, для которых снят образ
+    uint8_t regsLo[SX1276_IMG_LO_LEN];
+    uint8_t regsModem[SX1276_IMG_MODEM_LEN];
+    uint8_t paDac;
+    uint8_t reserved;
+    uint32_t crc;         // CRC-32 всех полей выше
+};
+
+/**
+ * @brief Частота в МГц для API RadioLib. RadioLib принимает частоту и полосу только во float,
+ * поэтому преобразование из целых единиц конфигурации выполняется здесь и только при настройке радио.
+ */
+inline float radioLibFrequency(const DeviceConfig& cfg) {
+    return cfg.radio_frequency / 1000000.0f;
+}
+
+/**
+ * @brief Полоса в кГц для API RadioLib.
+ */
+inline float radioLibBandwidth(const DeviceConfig& cfg) {
+    return cfg.radio_bandwidth / 10.0f;
+}
+
+/**
+ * SX1276 с доступом к кэшу параметров RadioLib.
+ *
+ * При старте из образа radio.begin() не вызывается, поэтому поля, по которым
+ * RadioLib считает время в эфире, RSSI и ошибку частоты, нужно заполнить вручную.
+ */
+class KaskaSX1276 : public SX1276 {
+public:
+    using SX1276::SX1276;
+
+    /**
+     * @brief Заполняет кэш параметров модема RadioLib из конфигурации без обращения к чипу.
+     */
+    void syncModemState(const DeviceConfig& cfg);
+};
+
+/**
+ * @brief Быстрый старт: восстанавливает образ регистров из EEPROM и запускает прием.
+ *
+ * Если чип уже содержит тот же образ (сброс только МК по watchdog/brownout),
+ * запись регистров пропускается.
+ *
+ * @return true если прием запущен из образа; false если образ недействителен
+ *         и нужна полная инициализация через radio.begin()
+ */
+bool radioImageRestore(KaskaSX1276& radio, const DeviceConfig& cfg);
+
+/**
+ * @brief Снимает образ регистров после полной инициализации и сохраняет его в EEPROM.
+ * Записываются только изменившиеся байты.
+ */
+void radioImageCapture(KaskaSX1276& radio, const DeviceConfig& cfg);
+
+/**
+ * @brief SNR последнего пакета в единицах 0.25 дБ (целочисленно, без float из RadioLib).
+ */
+int8_t sx1276PacketSnrQ4(KaskaSX1276& radio);
+
+/**
+ * @brief RSSI последнего пакета в дБм (формула даташита, без float). Смещение
+ * выбирается по порту текущей частоты: HF от ~780 МГц (SX1276_FRF_MSB_HF), LF ниже.
+ */
+int16_t sx1276PacketRssi(KaskaSX1276& radio);
+
+/**
+ * @brief Мгновенный RSSI канала в дБм (RegRssiValue, порт по текущей частоте). Действителен в режиме приема.
+ */
+int16_t sx1276CurrentRssi(KaskaSX1276& radio);
+
+/**
+ * @brief 32 бита шума из младшего бита широкополосного RSSI. Радио должно быть в приеме.
+ */
+uint32_t sx1276RandomSeed(KaskaSX1276& radio);
+
+/**
+ * @brief Ошибка частоты последнего пакета в Гц (RegFei, целочисленно).
+ * Действительна до следующего перехода в прием.
+ * @param bandwidthHz Полоса модема в Гц
+ */
+int32_t sx1276FreqErrorHz(KaskaSX1276& radio, uint32_t bandwidthHz);
+
+/**
+ * @brief Длительность символа LoRa в мкс.
+ * @param bandwidth Полоса в 0.1 кГц, как radio_bandwidth
+ */
+inline uint32_t loraSymbolUs(uint8_t sf, uint16_t bandwidth) {
+    return (1UL << sf) * 10000UL / bandwidth;
+}
+
+/**
+ * @brief Время в эфире кадра LoRa в мкс по формуле Semtech AN1200.13, целочисленно.
+ *
+ * Явный заголовок и CRC, как в Meshtastic; LowDataRateOptimize включается
+ * при символе от 16 мс, как в RadioLib.
+ *
+ * @param len Длина полезной нагрузки в байтах
+ */
+uint32_t loraTimeOnAirUs(const DeviceConfig& cfg, uint8_t len);
+
+#endif // SX1276_REGS_H
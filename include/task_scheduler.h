@@ -0,0 +1,86 @@
+#ifndef TASK_SCHEDULER_H
+#define TASK_SCHEDULER_H
+
+#include <Arduino.h>
+
+// Максимальное число задач (блоки управления выделяются статически)
+#define TASK_MAX 6
+
+#define TASK_INVALID 0xFF
+
+enum TaskState : uint8_t {
+    TASK_WAITING,   // Ждет условия, можно спать
+    TASK_YIELDED,   // Уступила управление, готова продолжить
+    TASK_DONE,      // Дошла до конца, следующий вызов начнет сначала
+};
+
+struct Task;
+typedef TaskState (*TaskFunc)(Task* t);
+typedef uint8_t TaskId;
+
+/**
+ * Блок управления задачей. Собственного стека у задачи нет: все задачи
+ * выполняются на стеке loop(), а между вызовами хранится только точка продолжения.
+ */
+struct Task {
+    TaskFunc func;
+    const char* name;
+    uint16_t lc;                    // Строка, на которой задача остановилась (0 - начало)
+    volatile bool signalled;
+    volatile uint32_t signalUs;     // micros() в момент taskSignal()
+    uint32_t runs;
+    uint32_t runUs;                 // Суммарное время выполнения
+    uint32_t maxRunUs;              // Самый долгий вызов (на столько задача задерживает остальные)
+    uint32_t maxLatencyUs;          // Наибольшая задержка от taskSignal() до обработки
+};
+
+/*
+ * Протопотоки: тело задачи оборачивается в switch по lc, ожидание запоминает
+ * __LINE__ и возвращает управление, следующий вызов продолжает с того же места.
+ *
+ * Ограничения: локальные переменные не переживают ожидание (нужны static или
+ * поля модуля), внутри задачи нельзя использовать switch вокруг ожиданий,
+ * в одной строке допускается одно ожидание, и ожидание не может перепрыгивать
+ * через объявление с инициализацией - обработку удобнее выносить в обычные функции.
+ */
+#define TASK_BEGIN(t)   switch ((t)->lc) { case 0:
+
+#define TASK_END(t)     } (t)->lc = 0; return TASK_DONE
+
+#define TASK_WAIT_UNTIL(t, cond) \
+    do { (t)->lc = __LINE__; case __LINE__: if (!(cond)) return TASK_WAITING; } while (0)
+
+#define TASK_WAIT_SIGNAL(t)  TASK_WAIT_UNTIL(t, taskTakeSignal(t))
+
+#define TASK_YIELD(t) \
+    do { (t)->lc = __LINE__; return TASK_YIELDED; case __LINE__:; } while (0)
+
+/**
+ * @brief Регистрирует задачу. Вызывать при инициализации.
+ * @return идентификатор или TASK_INVALID, если слоты кончились
+ */
+TaskId taskCreate(const char* name, TaskFunc func);
+
+/**
+ * @brief Будит задачу. Можно вызывать из прерывания и обработчика таймера.
+ */
+void taskSignal(TaskId id);
+
+/**
+ * @brief Забирает сигнал задачи и учитывает задержку его обработки.
+ * @return true если сигнал был
+ */
+bool taskTakeSignal(Task* t);
+
+/**
+ * @brief Один проход по всем задачам. Вызывать из loop().
+ * @return true если есть готовые задачи и спать нельзя
+ */
+bool taskRunAll();
+
+/**
+ * @brief Таблица задач: число вызовов, время выполнения и задержки в мкс.
+ */
+void taskPrintStats(Print& out);
+
+#endif // TASK_SCHEDULER_H
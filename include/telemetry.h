@@ -0,0 +1,27 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <Arduino.h>
+
+// Маяк уходит в основной канал (LongFast, ключ aes_key)
+#define TELEMETRY_CHAN_HASH       0x08
+#define TELEMETRY_HOP_LIMIT       3
+#define TELEMETRY_RETRY_MS        2000  // Повтор, если слот передачи занят ретрансляцией
+#define TELEMETRY_BATTERY_FULL_MV 4200  // 100% для battery_level; 0% - battery_threshold
+
+/**
+ * @brief Вычисляет номер узла и, если telemetry_interval задан, запускает
+ * периодический маяк. Вызывать в setup() после relayInit().
+ *
+ * Маяк - пакет Meshtastic TELEMETRY от имени ретранслятора. Варианты чередуются:
+ * DeviceMetrics (батарея, загрузка канала, доля передачи, время работы) и
+ * LocalStats (те же загрузки и счетчики приема, ретрансляции и дубликатов).
+ */
+void telemetryInit();
+
+/**
+ * @brief Номер узла Meshtastic ретранслятора: CRC-32 уникального ID контроллера.
+ */
+uint32_t telemetryNodeNum();
+
+#endif // TELEMETRY_H
@@ -0,0 +1,47 @@
+#ifndef TIMER_SERVICE_H
+#define TIMER_SERVICE_H
+
+#include <Arduino.h>
+
+// Максимальное число таймеров (слоты выделяются статически)
+#define TIMER_MAX 8
+
+#define TIMER_INVALID 0xFF
+#define TIMER_NONE    0xFFFFFFFFUL   // Нет активных таймеров
+
+typedef void (*TimerCallback)();
+typedef uint8_t TimerId;
+
+/**
+ * @brief Регистрирует таймер. Вызывать при инициализации.
+ * @return идентификатор или TIMER_INVALID, если слоты кончились
+ */
+TimerId timerCreate(TimerCallback callback);
+
+/**
+ * @brief Запускает (или перезапускает) таймер.
+ *
+ * @param delayMs Через сколько мс выполнить
+ * @param periodMs Период повтора, 0 - однократно
+ */
+void timerStart(TimerId id, uint32_t delayMs, uint32_t periodMs = 0);
+
+void timerStop(TimerId id);
+
+bool timerActive(TimerId id);
+
+/**
+ * @brief Выполняет обработчики таймеров, срок которых наступил. Вызывать из loop().
+ *
+ * Обработчики выполняются в контексте loop(), а не прерывания, и могут
+ * перезапускать любые таймеры, в том числе свой.
+ */
+void timerRunDue(uint32_t nowMs);
+
+/**
+ * @brief Время до ближайшего срока среди всех таймеров.
+ * @return мс (0 - срок уже наступил) или TIMER_NONE
+ */
+uint32_t timerMsUntilNext(uint32_t nowMs);
+
+#endif // TIMER_SERVICE_H
@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+# Сравнение использования памяти между окружениями PlatformIO
+# (по умолчанию отладочная и производственная сборки)
+
+set -euo pipefail
+
+# Путь к PlatformIO
+PIO_BIN="${PIO_BIN:-$HOME/.platformio/penv/bin/pio}"
+
+if ! command -v "$PIO_BIN" &> /dev/null; then
+    echo "Ошибка: PlatformIO не найден по пути $PIO_BIN" >&2
+    exit 1
+fi
+
+BASE_ENV="${1:-lora-kaska}"
+TARGET_ENV="${2:-lora-kaska-prod}"
+
+# Извлекает "used" байты из строки вида "Flash: [====] 90.1% (used 59012 bytes from 65536 bytes)"
+extract_used() {
+    local output="$1"
+    local kind="$2"
+    echo "$output" | grep -E "^${kind}:" | sed -E 's/.*used[[:space:]]+([0-9]+)[[:space:]]+bytes.*/\1/'
+}
+
+build_env() {
+    local env="$1"
+    "$PIO_BIN" run -e "$env" 2>&1
+}
+
+echo "Сборка $BASE_ENV..."
+BASE_OUTPUT=$(build_env "$BASE_ENV")
+echo "Сборка $TARGET_ENV..."
+TARGET_OUTPUT=$(build_env "$TARGET_ENV")
+
+BASE_FLASH=$(extract_used "$BASE_OUTPUT" Flash)
+TARGET_FLASH=$(extract_used "$TARGET_OUTPUT" Flash)
+BASE_RAM=$(extract_used "$BASE_OUTPUT" RAM)
+TARGET_RAM=$(extract_used "$TARGET_OUTPUT" RAM)
+
+if [ -z "$BASE_FLASH" ] || [ -z "$TARGET_FLASH" ]; then
+    echo "Не удалось извлечь статистику сборки" >&2
+    exit 1
+fi
+
+echo ""
+printf "%-20s %10s %10s\n" "Окружение" "Flash" "RAM"
+printf "%-20s %10s %10s\n" "$BASE_ENV" "$BASE_FLASH" "$BASE_RAM"
+printf "%-20s %10s %10s\n" "$TARGET_ENV" "$TARGET_FLASH" "$TARGET_RAM"
+echo ""
+echo "Освобождено Flash: $((BASE_FLASH - TARGET_FLASH)) байт"
+echo "Освобождено RAM:   $((BASE_RAM - TARGET_RAM)) байт"
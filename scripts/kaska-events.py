@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+# Декодер двоичного потока ретранслятора: события (UART команда evs=1) и захват пакетов (cap=1).
+# Кадры: COBS([type][data]) + 0x00. Текстовый лог между кадрами выводится как есть.
+# Захваченные пакеты сохраняются в pcap (LoRaTap, LINKTYPE 270) для Wireshark.
+
+import argparse
+import struct
+import sys
+import time
+
+FRAME_TYPE_EVENT = 0x01
+FRAME_TYPE_CAPTURE = 0x02
+
+# struct EventRecord (include/event_log.h), little endian, packed
+EVENT_FORMAT = "<IBBBBIIhbB"
+EVENT_SIZE = struct.calcsize(EVENT_FORMAT)
+
+EVENT_NAMES = {
+    1: "BOOT", 2: "NEW", 3: "DUP", 4: "SHORT", 5: "RXERR",
+    6: "RELAY", 7: "BUSY", 8: "BATT", 9: "SHUTDN", 10: "POWER", 11: "SKIP", 12: "LAT",
+    13: "POLICY", 14: "FLOOD",
+}
+EVENT_RELAY_LATENCY = 12
+PACKET_EVENTS = (2, 3, 4, 6, 7, 11, 13, 14)
+
+# struct CaptureRecord (include/packet_capture.h), за ним сырые байты пакета
+CAPTURE_FORMAT = "<IiIHhbBBB"
+CAPTURE_SIZE = struct.calcsize(CAPTURE_FORMAT)
+CAPTURE_MAX_PACKET = 255
+
+VERDICT_NAMES = {0: "NEW", 1: "DUP", 2: "SHORT", 3: "CRCERR", 4: "RELAY", 5: "BUSY", 6: "PWRSKIP", 7: "NEXTHOP",
+                 8: "POLICY", 9: "FLOOD"}
+
+# Допустимая длина данных кадра (без байта типа)
+FRAME_SIZES = {
+    FRAME_TYPE_EVENT: (EVENT_SIZE, EVENT_SIZE),
+    FRAME_TYPE_CAPTURE: (CAPTURE_SIZE, CAPTURE_SIZE + CAPTURE_MAX_PACKET),
+}
+
+LINKTYPE_LORATAP = 270
+
+
+def cobs_decode(data):
+    out = bytearray()
+    i = 0
+    while i < len(data):
+        code = data[i]
+        if code == 0 or i + code > len(data):
+            return None
+        out += data[i + 1:i + code]
+        i += code
+        if code < 0xFF and i < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def split_frame(chunk):
+    """Ищет в куске между разделителями кадр известного типа. Возвращает (текст, кадр)."""
+    for start in range(len(chunk)):
+        raw = cobs_decode(chunk[start:])
+        if raw and raw[0] in FRAME_SIZES:
+            low, high = FRAME_SIZES[raw[0]]
+            if low <= len(raw) - 1 <= high:
+                return chunk[:start], raw
+    return chunk, None
+
+
+def bcd(v):
+    return (v >> 4) * 10 + (v & 0x0F)
+
+
+def stamp_to_ms(stamp):
+    """Метка rtcStamp() (src/rtc_clock.cpp): регистр TR в BCD и доля секунды в 1/1024 -> мс от начала суток."""
+    tr = stamp >> 10
+    seconds = bcd((tr >> 16) & 0x3F) * 3600 + bcd((tr >> 8) & 0x7F) * 60 + bcd(tr & 0x7F)
+    return seconds * 1000 + (stamp & 0x3FF) * 1000 // 1024
+
+
+def format_event(payload):
+    stamp, ev, flags, chan, relay, a, b, rssi, snr, length = struct.unpack(EVENT_FORMAT, payload)
+    ts = stamp_to_ms(stamp)
+    name = EVENT_NAMES.get(ev, "?%d" % ev)
+    if ev in PACKET_EVENTS:
+        return ("%10d %-6s from=0x%08x id=0x%08x hop=%d/%d ch=0x%02x relay=0x%02x "
+                "rssi=%d snr=%.2f len=%d" % (ts, name, a, b, (flags >> 5) & 7, flags & 7,
+                                             chan, relay, rssi, snr / 4.0, length))
+    if ev == EVENT_RELAY_LATENCY:
+        return "%10d %-6s delay=%d busy=%d proc_us=%d air=%d" % (
+            ts, name, a & 0xFFFF, a >> 16, b & 0xFFFF, b >> 16)
+    return "%10d %-6s %d %d" % (ts, name, a, b)
+
+
+class PcapWriter:
+    """pcap с заголовком LoRaTap v0 (15 байт) перед каждым пакетом."""
+
+    def __init__(self, stream, args):
+        self.stream = stream
+        self.args = args
+        stream.write(struct.pack("<IHHiIII", 0xA1B2C3D4, 2, 4, 0, 0, 65535, LINKTYPE_LORATAP))
+
+    def write(self, ts_ms, rec, packet):
+        a = self.args
+        _, _, freq, bw, rssi, snr, _, _, sf = rec
+        rssi_raw = max(0, min(255, rssi + 139))  # Wireshark: RSSI = value - 139
+        # Полоса в кадре в 0.1 кГц, в LoRaTap - в единицах 125 кГц
+        loratap = struct.pack(">BBHIBBBBBbB", 0, 0, 15, freq, max(1, round(bw / 1250.0)), sf,
+                              rssi_raw, rssi_raw, rssi_raw, snr, a.sync)
+        if a.host_time:
+            ts_ms = int(time.time() * 1000)
+        data = loratap + packet
+        self.stream.write(struct.pack("<IIII", ts_ms // 1000, ts_ms % 1000 * 1000, len(data), len(data)))
+        self.stream.write(data)
+        self.stream.flush()
+
+
+def format_capture(rec, packet):
+    stamp, ferr, freq, bw, rssi, snr, verdict, preset, sf = rec
+    ts = stamp_to_ms(stamp)
+    name = VERDICT_NAMES.get(verdict, "?%d" % verdict)
+    line = "%10d CAP    %-6s p%d %.3f/%.1f/SF%d rssi=%d snr=%.2f ferr=%d len=%d" % (
+        ts, name, preset, freq / 1e6, bw / 10.0, sf, rssi, snr / 4.0, ferr, len(packet))
+    if len(packet) >= 8:
+        dest, sender = struct.unpack("<II", packet[:8])
+        line += " from=0x%08x to=0x%08x" % (sender, dest)
+    return line
+
+
+def handle_frame(raw, args):
+    if raw[0] == FRAME_TYPE_EVENT:
+        print(format_event(raw[1:]))
+    elif raw[0] == FRAME_TYPE_CAPTURE:
+        rec = struct.unpack(CAPTURE_FORMAT, raw[1:1 + CAPTURE_SIZE])
+        packet = raw[1 + CAPTURE_SIZE:]
+        if not args.quiet:
+            print(format_capture(rec, packet))
+        if args.pcap:
+            args.pcap.write(stamp_to_ms(rec[0]), rec, packet)
+
+
+def run(stream, args):
+    buf = bytearray()
+    while True:
+        data = stream.read(1 if args.port else 4096)
+        if not data:
+            break
+        buf += data
+        while True:
+            pos = buf.find(b"\x00")
+            if pos < 0:
+                break
+            chunk, buf = bytes(buf[:pos]), buf[pos + 1:]
+            text, raw = split_frame(chunk)
+            if text and not args.quiet:
+                sys.stdout.write(text.decode("utf-8", "replace"))
+            if raw:
+                handle_frame(raw, args)
+        sys.stdout.flush()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Декодер двоичного потока событий meshtastic-kaska")
+    parser.add_argument("source", nargs="?", help="файл с дампом UART (по умолчанию stdin)")
+    parser.add_argument("-p", "--port", help="последовательный порт (нужен pyserial)")
+    parser.add_argument("-b", "--baud", type=int, default=57600)
+    parser.add_argument("-q", "--quiet", action="store_true", help="не выводить текстовый лог и строки захвата")
+    parser.add_argument("-w", "--write", metavar="FILE", help="записывать захваченные пакеты в pcap (LoRaTap)")
+    parser.add_argument("--host-time", action="store_true",
+                        help="метки времени pcap по часам ПК вместо времени суток RTC ретранслятора")
+    # Sync word для заголовка LoRaTap в кадре захвата не передается
+    parser.add_argument("--sync", type=lambda v: int(v, 0), default=0x2B, help="sync word")
+    args = parser.parse_args()
+    args.pcap = PcapWriter(open(args.write, "wb"), args) if args.write else None
+
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+    elif args.source:
+        stream = open(args.source, "rb")
+    else:
+        stream = sys.stdin.buffer
+    try:
+        run(stream, args)
+    except KeyboardInterrupt:
+        pass
+
+
+if __name__ == "__main__":
+    main()
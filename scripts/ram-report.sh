@@ -0,0 +1,79 @@
+#!/usr/bin/env bash
+# Разметка RAM собранной прошивки: статические данные по символам и области арены
+# (размеры из include/ram_arena.h, границы - по символам компоновщика в ELF)
+
+set -euo pipefail
+
+cd "$(dirname "$0")/.."
+
+ENV="${1:-lora-kaska}"
+TOP="${2:-12}"            # Сколько крупнейших статических символов показать
+ELF=".pio/build/$ENV/firmware.elf"
+HEADER="include/ram_arena.h"
+NM="${NM:-$HOME/.platformio/packages/toolchain-gccarmnoneeabi/bin/arm-none-eabi-nm}"
+
+if [ ! -f "$ELF" ]; then
+    echo "Ошибка: нет $ELF, сначала выполните pio run -e $ENV" >&2
+    exit 1
+fi
+if ! command -v "$NM" &> /dev/null; then
+    echo "Ошибка: arm-none-eabi-nm не найден по пути $NM" >&2
+    exit 1
+fi
+
+# Адрес символа компоновщика в десятичном виде
+sym() {
+    local hex
+    hex=$("$NM" "$ELF" | awk -v s="$1" '$3 == s { print $1; exit }')
+    if [ -z "$hex" ]; then
+        echo "Ошибка: символ $1 не найден в $ELF" >&2
+        exit 1
+    fi
+    echo $((16#$hex))
+}
+
+# Значение #define из заголовка арены
+define() {
+    sed -nE "s/^#define $1[[:space:]]+([0-9]+).*/\1/p" "$HEADER"
+}
+
+SDATA=$(sym _sdata)
+END=$(sym _end)
+ESTACK=$(sym _estack)
+MIN_STACK=$(sym _Min_Stack_Size)
+TOTAL=$((ESTACK - SDATA))
+
+HEAP=$(define ARENA_HEAP_RESERVE)
+RX=$(define ARENA_RX_SIZE)
+TX=$(define ARENA_TX_SIZE)
+SCRATCH=$(define ARENA_SCRATCH_SIZE)
+
+# Та же разметка, что в arenaInit()
+BASE=$(( (END + HEAP + 7) & ~7 ))
+ARENA_END=$(( ((ESTACK - MIN_STACK) & ~7) - 8 ))
+CACHE=$(( ARENA_END - BASE - RX - TX - SCRATCH ))
+if [ "$CACHE" -lt 0 ]; then
+    echo "Ошибка: статические данные и фиксированные области не помещаются в RAM ($CACHE байт)" >&2
+    exit 1
+fi
+
+row() {
+    printf "%-28s %6d %5d%%\n" "$1" "$2" $(( $2 * 100 / TOTAL ))
+}
+
+echo "Окружение $ENV, RAM $TOTAL байт"
+echo ""
+printf "%-28s %6s %6s\n" "Область" "Байт" "Доля"
+row "static (.data + .bss)" $((END - SDATA))
+row "heap (RadioLib)" $((BASE - END))
+row "rx" "$RX"
+row "tx" "$TX"
+row "scratch" "$SCRATCH"
+row "cache ($((CACHE / 8)) слотов)" "$CACHE"
+row "stack" $((ESTACK - ARENA_END))
+
+echo ""
+echo "Крупнейшие статические символы:"
+"$NM" -S --size-sort -r "$ELF" | awk '$3 ~ /^[bBdD]$/' | head -n "$TOP" | while read -r _ size _ name; do
+    row "$name" $((16#$size))
+done
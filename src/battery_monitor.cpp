@@ -0,0 +1,117 @@
+#include "battery_monitor.h"
+#include "config_storage.h"
+
+// BAT_PIN (PA3) - вход ADC_IN3, в аналоговый режим переводится в setup()
+#define BAT_ADC_CHANNEL ADC_CHANNEL_3
+
+#ifndef ADC_SAMPLINGTIME
+#define ADC_SAMPLINGTIME ADC_SAMPLETIME_160CYCLES_5
+#endif
+
+static uint16_t lastMillivolts = 0;
+static uint16_t lastRaw = 0;
+static uint32_t lastSampleMs = 0;
+static bool sampled = false;
+static uint8_t belowCount = 0;
+
+/**
+ * @brief Одно преобразование с аппаратным оверсемплингом.
+ *
+ * Вызывается редко, поэтому АЦП настраивается заново при каждом измерении,
+ * а между измерениями регулятор АЦП выключен.
+ */
+static uint16_t adcReadOversampled() {
+    ADC_HandleTypeDef hadc = {};
+    hadc.Instance = ADC1;
+    hadc.Init.ClockPrescaler = ADC_CLOCK_SYNC_PCLK_DIV2;
+    hadc.Init.Resolution = ADC_RESOLUTION_12B;
+    hadc.Init.DataAlign = ADC_DATAALIGN_RIGHT;
+    hadc.Init.ScanConvMode = ADC_SCAN_DIRECTION_FORWARD;
+    hadc.Init.EOCSelection = ADC_EOC_SINGLE_CONV;
+    hadc.Init.ContinuousConvMode = DISABLE;
+    hadc.Init.DiscontinuousConvMode = DISABLE;
+    hadc.Init.ExternalTrigConv = ADC_SOFTWARE_START;
+    hadc.Init.ExternalTrigConvEdge = ADC_EXTERNALTRIGCONVEDGE_NONE;
+    hadc.Init.DMAContinuousRequests = DISABLE;
+    hadc.Init.Overrun = ADC_OVR_DATA_OVERWRITTEN;
+    hadc.Init.LowPowerAutoWait = DISABLE;
+    hadc.Init.LowPowerAutoPowerOff = DISABLE;
+    hadc.Init.LowPowerFrequencyMode = DISABLE;
+    // Делитель батареи высокоомный: выборка должна быть длинной
+    hadc.Init.SamplingTime = ADC_SAMPLINGTIME;
+    hadc.Init.OversamplingMode = ENABLE;
+    hadc.Init.Oversample.Ratio = BATTERY_OVERSAMPLING_RATIO;
+    hadc.Init.Oversample.RightBitShift = BATTERY_OVERSAMPLING_SHIFT;
+    hadc.Init.Oversample.TriggeredMode = ADC_TRIGGEREDMODE_SINGLE_TRIGGER;
+
+    __HAL_RCC_ADC1_CLK_ENABLE();
+    uint16_t raw = 0;
+    if (HAL_ADC_Init(&hadc) == HAL_OK &&
+        HAL_ADCEx_Calibration_Start(&hadc, ADC_SINGLE_ENDED) == HAL_OK) {
+        ADC_ChannelConfTypeDef channel = {};
+        channel.Channel = BAT_ADC_CHANNEL;
+        channel.Rank = ADC_RANK_CHANNEL_NUMBER;
+        HAL_ADC_ConfigChannel(&hadc, &channel);
+
+        // 16 выборок по 173 такта АЦП: ~350 мкс, прерывание не нужно
+        if (HAL_ADC_Start(&hadc) == HAL_OK && HAL_ADC_PollForConversion(&hadc, 10) == HAL_OK) {
+            raw = HAL_ADC_GetValue(&hadc);
+        }
+        HAL_ADC_Stop(&hadc);
+    }
+    HAL_ADC_DeInit(&hadc);
+    __HAL_RCC_ADC1_CLK_DISABLE();
+    return raw;
+}
+
+uint16_t batteryMeasureMillivolts() {
+    lastRaw = adcReadOversampled();
+    // Теоретический коэффициент для делителя 1/2 и Vref 2.5V:
+    // (2.5 / 4095) * 2 = 0.00122100122
+    // Фактически при 4.01В на входе АЦП выдает raw=2288.
+    // Это означает, что реальный коэффициент составляет 4.01 / 2288 ≈ 0.00175262 (1753 мкВ).
+    // Разница может быть вызвана отклонением Vref от 2.5В или погрешностью резисторов.
+    return (lastRaw * currentConfig.adc_multiplier + 500) / 1000;
+}
+
+/**
+ * @brief Интервал до следующего измерения по запасу до порога и скорости падения (мВ/мин).
+ */
+static uint32_t nextInterval(uint16_t mv, int32_t dropPerMin) {
+    if (belowCount > 0) return BATTERY_CONFIRM_INTERVAL_MS;
+    int32_t margin = (int32_t)mv - currentConfig.battery_threshold;
+    if (margin < 100 || dropPerMin > 20) return BATTERY_INTERVAL_SHORT_MS;
+    if (margin < 300 || dropPerMin > 5) return BATTERY_INTERVAL_MS;
+    return BATTERY_INTERVAL_LONG_MS;
+}
+
+uint32_t batteryMonitorSample(uint32_t nowMs) {
+    uint16_t mv = batteryMeasureMillivolts();
+    int32_t dropPerMin = 0;
+    if (sampled && nowMs != lastSampleMs) {
+        dropPerMin = ((int32_t)lastMillivolts - mv) * 60000 / (int32_t)(nowMs - lastSampleMs);
+    }
+
+    if (mv < currentConfig.battery_threshold) {
+        if (belowCount < BATTERY_SHUTDOWN_SAMPLES) belowCount++;
+    } else {
+        belowCount = 0;
+    }
+
+    lastMillivolts = mv;
+    lastSampleMs = nowMs;
+    sampled = true;
+    return nextInterval(mv, dropPerMin);
+}
+
+uint16_t batteryMillivolts() {
+    return lastMillivolts;
+}
+
+uint16_t batteryRawAdc() {
+    return lastRaw;
+}
+
+bool batteryShutdownRequired() {
+    return belowCount >= BATTERY_SHUTDOWN_SAMPLES;
+}
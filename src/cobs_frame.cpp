@@ -0,0 +1,44 @@
+#include "cobs_frame.h"
+#include "log.h"
+
+// 1 байт типа + данные, накладные расходы COBS (1 байт на 254) и разделитель
+#define FRAME_MAX_ENCODED (1 + FRAME_MAX_DATA + (1 + FRAME_MAX_DATA) / 254 + 2)
+
+// Кадр кодируется прямо в TX-буфер Serial и должен помещаться в него целиком
+static_assert(SERIAL_TX_BUFFER_SIZE - 1 >= FRAME_MAX_ENCODED, "SERIAL_TX_BUFFER_SIZE is too small for a capture frame");
+
+/**
+ * @brief Байт кадра по сквозному номеру: тип, затем head, затем tail.
+ */
+static inline uint8_t frameByte(uint8_t type, const uint8_t* head, size_t headLen, const uint8_t* tail, size_t i) {
+    if (i == 0) return type;
+    return i <= headLen ? head[i - 1] : tail[i - 1 - headLen];
+}
+
+bool sendFrame(uint8_t type, const void* head, size_t headLen, const void* tail, size_t tailLen) {
+    if (headLen + tailLen > FRAME_MAX_DATA) return false;
+    const uint8_t* h = (const uint8_t*)head;
+    const uint8_t* t = (const uint8_t*)tail;
+    size_t total = 1 + headLen + tailLen;
+
+    // Место под худший случай резервируется заранее: кадр не рвется потерей середины
+    if (!Log.reserve(total + total / 254 + 2)) return false;
+
+    // Блок - байт-код и до 254 ненулевых байт; длина блока находится просмотром вперед
+    size_t i = 0;
+    for (;;) {
+        size_t end = i;
+        while (end < total && end - i < 254 && frameByte(type, h, headLen, t, end) != 0) end++;
+        Log.writeReserved(end - i + 1);
+        for (size_t k = i; k < end; k++) Log.writeReserved(frameByte(type, h, headLen, t, k));
+        // Полный блок (код 0xFF) не заменяет нулевой байт
+        if (end - i == 254) {
+            i = end;
+            continue;
+        }
+        if (end == total) break;
+        i = end + 1;
+    }
+    Log.writeReserved(0x00);
+    return true;
+}
@@ -1,58 +1,415 @@
 #include "config_storage.h"
 #include <EEPROM.h>
+#include <stddef.h>
+#include "crc32.h"
+#include "fixed_point.h"
+#include "log.h"
 
 const DeviceConfig DEFAULT_CONFIG = {
-    .magic = CONFIG_MAGIC,
-    .version = CONFIG_VERSION,
-    .radio_frequency = 869.085f,
-    .radio_bandwidth = 250.0f,
+    .radio_frequency = 869085000,
+    .radio_bandwidth = 2500,
     .radio_spreadingFactor = 11,
     .radio_codingRate = 5,
     .radio_syncWord = 0x2B,
     .radio_preambleLength = 16,
-    .adc_multiplier = 0.00175262f,
-    .battery_threshold = 3.5f,
+    .adc_multiplier = 1753,
+    .battery_threshold = 3500,
     .aes_key = {0xd4, 0xf1, 0xbb, 0x3a, 0x20, 0x29, 0x07, 0x59,
                 0xf0, 0xbc, 0xff, 0xab, 0xcf, 0x4e, 0x69, 0x01},
     .log_level = 2, // Default to highest for debugging
     .relay_delay = 100, // Default 100ms
-    .checksum = 0
+    .event_stream = 0,
+    .capture_stream = 0,
+    .power_eco_threshold = 3700,
+    .power_critical_threshold = 3600,
+    .power_hysteresis = 50,
+    .current_stop = 50,
+    .current_run = 5000,
+    .current_uart = 1500,
+    .current_rx = 11500,
+    .current_tx = 10000,
+    .current_tx_dbm = 5000,
+    .battery_capacity = 2000,
+    .relay_id = 0,
+    .next_hop_timeout = 5000,
+    .flood_share = 25,
+    .scan_mode = 0,
+    .lbt_rssi = -100,
+    .telemetry_interval = 0,
 };
 
-uint16_t calculateChecksum(const DeviceConfig& cfg) {
-    const uint8_t* data = (const uint8_t*)&cfg;
+// Идентификатор записи: номер поля (старшие 5 бит) и версия представления (младшие 3 бита).
+// При смене типа или единиц поля ему выдается новая версия, а старая конвертируется в migrateRecord().
+// Выход за разрядность - ошибка компиляции: иначе номер молча переполнил бы байт и совпал с чужим.
+template <unsigned Field, unsigned Ver>
+struct CfgId {
+    static_assert(Field <= 31, "config field number must fit in 5 bits");
+    static_assert(Ver <= 7, "config field version must fit in 3 bits");
+    static constexpr uint8_t value = (uint8_t)((Field << 3) | Ver);
+};
+#define CFG_ID(field, ver) (CfgId<(field), (ver)>::value)
+
+struct ConfigField {
+    uint8_t id;
+    uint8_t offset;
+    uint8_t size;
+};
+
+#define CONFIG_FIELD(id, member) { id, offsetof(DeviceConfig, member), sizeof(DeviceConfig::member) }
+
+static const ConfigField CONFIG_FIELDS[] = {
+    CONFIG_FIELD(CFG_ID(1, 1),  radio_frequency),
+    CONFIG_FIELD(CFG_ID(2, 1),  radio_bandwidth),
+    CONFIG_FIELD(CFG_ID(3, 0),  radio_spreadingFactor),
+    CONFIG_FIELD(CFG_ID(4, 0),  radio_codingRate),
+    CONFIG_FIELD(CFG_ID(5, 0),  radio_syncWord),
+    CONFIG_FIELD(CFG_ID(6, 0),  radio_preambleLength),
+    CONFIG_FIELD(CFG_ID(7, 1),  adc_multiplier),
+    CONFIG_FIELD(CFG_ID(8, 1),  battery_threshold),
+    CONFIG_FIELD(CFG_ID(9, 0),  aes_key),
+    CONFIG_FIELD(CFG_ID(10, 0), log_level),
+    CONFIG_FIELD(CFG_ID(11, 0), relay_delay),
+    CONFIG_FIELD(CFG_ID(12, 0), event_stream),
+    CONFIG_FIELD(CFG_ID(13, 0), capture_stream),
+    CONFIG_FIELD(CFG_ID(14, 0), power_eco_threshold),
+    CONFIG_FIELD(CFG_ID(15, 0), power_critical_threshold),
+    CONFIG_FIELD(CFG_ID(16, 0), power_hysteresis),
+    CONFIG_FIELD(CFG_ID(17, 0), current_stop),
+    CONFIG_FIELD(CFG_ID(18, 0), current_run),
+    CONFIG_FIELD(CFG_ID(19, 0), current_uart),
+    CONFIG_FIELD(CFG_ID(20, 0), current_rx),
+    CONFIG_FIELD(CFG_ID(21, 0), current_tx),
+    CONFIG_FIELD(CFG_ID(22, 0), current_tx_dbm),
+    CONFIG_FIELD(CFG_ID(23, 0), battery_capacity),
+    CONFIG_FIELD(CFG_ID(24, 0), relay_id),
+    CONFIG_FIELD(CFG_ID(25, 0), next_hop_timeout),
+    CONFIG_FIELD(CFG_ID(26, 0), flood_share),
+    CONFIG_FIELD(CFG_ID(27, 0), scan_mode),
+    CONFIG_FIELD(CFG_ID(28, 0), lbt_rssi),
+    CONFIG_FIELD(CFG_ID(29, 0), telemetry_interval),
+};
+
+#define CONFIG_FIELD_COUNT (sizeof(CONFIG_FIELDS) / sizeof(CONFIG_FIELDS[0]))
+static_assert(CONFIG_FIELD_COUNT <= 32, "pendingFields and advancePage() keep fields in a 32-bit mask");
+#define CONFIG_RECORD_MAX_DATA 16
+#define NO_PAGE 0xFF
+
+struct LogPageHeader {
+    uint32_t pageSeq;
+    uint32_t crc;
+};
+
+// Состояние журнала
+static uint8_t activePage = 0;   // Страница, в которую дописываем
+static uint32_t activeSeq = 0;   // pageSeq активной страницы (0 - журнал пуст)
+static uint16_t writeOffset = CONFIG_LOG_PAGE_SIZE; // Заполненная страница вынуждает переход к следующей
+static uint8_t fieldPage[CONFIG_FIELD_COUNT];       // Страница последней записи поля, NO_PAGE - записи нет
+static DeviceConfig storedConfig;                   // Значения, записанные в журнал
+static uint32_t pendingFields;                      // Поля saveConfig(), еще не дописанные в журнал
+
+static inline uint16_t pageAddr(uint8_t page) {
+    return EEPROM_CONFIG_ADDR + page * CONFIG_LOG_PAGE_SIZE;
+}
+
+static uint32_t pageHeaderCrc(uint32_t pageSeq) {
+    const uint32_t magic = CONFIG_LOG_MAGIC;
+    return crc32Update(crc32(&magic, sizeof(magic)), &pageSeq, sizeof(pageSeq));
+}
+
+static uint32_t recordCrc(uint32_t pageSeq, const uint8_t* hdr, const uint8_t* data, uint8_t len) {
+    uint32_t crc = crc32(&pageSeq, sizeof(pageSeq));
+    crc = crc32Update(crc, hdr, 2);
+    return crc32Update(crc, data, len);
+}
+
+static void eepromWrite(uint16_t addr, const void* data, size_t len) {
+    const uint8_t* p = (const uint8_t*)data;
+    for (size_t i = 0; i < len; i++) {
+        EEPROM.update(addr + i, p[i]); // Пишем только отличающиеся байты
+    }
+}
+
+static int8_t findField(uint8_t id) {
+    for (uint8_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (CONFIG_FIELDS[i].id == id) return i;
+    }
+    return -1;
+}
+
+/**
+ * @brief Переносит значение из записи устаревшей версии представления поля.
+ *
+ * @return индекс поля в CONFIG_FIELDS, в которое записано значение; -1 если преобразование неизвестно
+ */
+// Версия 0 хранила эти поля во float. value = float * scale * mul, mul отбрасывает шум округления float
+struct FloatMigration {
+    uint8_t oldId;
+    uint8_t newId;
+    uint32_t scale;
+    uint16_t mul;
+};
+
+static const FloatMigration FLOAT_MIGRATIONS[] = {
+    {CFG_ID(1, 0), CFG_ID(1, 1), 1000, 1000},   // МГц -> Гц (с точностью до кГц)
+    {CFG_ID(2, 0), CFG_ID(2, 1), 10, 1},        // кГц -> 0.1 кГц
+    {CFG_ID(7, 0), CFG_ID(7, 1), 1000000, 1},   // В/ед. АЦП -> мкВ/ед. АЦП
+    {CFG_ID(8, 0), CFG_ID(8, 1), 1000, 1},      // В -> мВ
+};
+
+/**
+ * @brief Записывает целое значение в числовое поле конфигурации его размера (little endian).
+ */
+static void setFieldValue(DeviceConfig& cfg, uint8_t idx, uint32_t value) {
+    memcpy((uint8_t*)&cfg + CONFIG_FIELDS[idx].offset, &value, CONFIG_FIELDS[idx].size);
+}
+
+static int8_t migrateRecord(uint8_t id, const uint8_t* data, uint8_t len, DeviceConfig& cfg) {
+    for (uint8_t i = 0; i < sizeof(FLOAT_MIGRATIONS) / sizeof(FLOAT_MIGRATIONS[0]); i++) {
+        const FloatMigration& m = FLOAT_MIGRATIONS[i];
+        if (m.oldId != id || len != sizeof(uint32_t)) continue;
+        uint32_t bits;
+        memcpy(&bits, data, sizeof(bits));
+        int8_t idx = findField(m.newId);
+        setFieldValue(cfg, idx, (uint32_t)floatBitsToFixed(bits, m.scale) * m.mul);
+        return idx;
+    }
+    return -1;
+}
+
+static void advancePage();
+
+/**
+ * @brief Дописывает запись поля из storedConfig в активную страницу.
+ */
+static void appendField(uint8_t idx) {
+    const ConfigField& f = CONFIG_FIELDS[idx];
+    uint16_t recSize = 2 + f.size + 4;
+    // Перенос мог заполнить и новую страницу
+    while (writeOffset + recSize > CONFIG_LOG_PAGE_SIZE) {
+        advancePage();
+    }
+
+    uint16_t addr = pageAddr(activePage) + writeOffset;
+    const uint8_t hdr[2] = {f.id, f.size};
+    const uint8_t* data = (const uint8_t*)&storedConfig + f.offset;
+    uint32_t crc = recordCrc(activeSeq, hdr, data, f.size);
+
+    eepromWrite(addr, hdr, 2);
+    eepromWrite(addr + 2, data, f.size);
+    eepromWrite(addr + 2 + f.size, &crc, 4);
+
+    writeOffset += recSize;
+    fieldPage[idx] = activePage;
+    pendingFields &= ~(1UL << idx);
+}
+
+/**
+ * @brief Начинает следующую (самую старую) страницу кольца.
+ *
+ * Заголовок с новым pageSeq делает прежние записи страницы нечитаемыми, поэтому
+ * живых записей на ней быть не должно. Для этого при начале страницы на нее
+ * переносятся живые записи следующей по кольцу: к ее переиспользованию они уже
+ * будут лежать здесь. При обрыве питания во время переноса исходные записи
+ * остаются целыми, а перенос завершает loadConfig().
+ */
+static void advancePage() {
+    uint8_t next = (activePage + 1) % CONFIG_LOG_PAGES;
+    uint8_t after = (next + 1) % CONFIG_LOG_PAGES;
+
+    // Живые записи на самой странице остаются только в журнале, записанном прошивкой
+    // без переноса на шаг вперед. Их значения берутся из storedConfig
+    uint32_t stale = 0;
+    for (uint8_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (fieldPage[i] == next) stale |= 1UL << i;
+    }
+
+    activePage = next;
+    activeSeq++;
+
+    LogPageHeader hdr = {activeSeq, pageHeaderCrc(activeSeq)};
+    eepromWrite(pageAddr(next), &hdr, sizeof(hdr));
+    writeOffset = sizeof(hdr);
+
+    // Записи одной страницы помещаются в пустую: без stale перенос не вызывает нового перехода
+    for (uint8_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (fieldPage[i] == after) appendField(i);
+    }
+    for (uint8_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (stale & (1UL << i)) appendField(i);
+    }
+}
+
+/**
+ * @brief Применяет записи страницы к конфигурации.
+ * @return смещение конца последней целой записи
+ */
+static uint16_t scanPage(uint8_t page, uint32_t pageSeq, DeviceConfig& cfg) {
+    uint16_t base = pageAddr(page);
+    uint16_t offset = sizeof(LogPageHeader);
+    uint8_t data[CONFIG_RECORD_MAX_DATA];
+
+    while (offset + 2 + 4 <= CONFIG_LOG_PAGE_SIZE) {
+        uint8_t hdr[2] = {EEPROM.read(base + offset), EEPROM.read(base + offset + 1)};
+        uint8_t len = hdr[1];
+        if (len > CONFIG_RECORD_MAX_DATA || offset + 2 + len + 4 > CONFIG_LOG_PAGE_SIZE) break;
+
+        for (uint8_t i = 0; i < len; i++) data[i] = EEPROM.read(base + offset + 2 + i);
+        uint32_t crc;
+        EEPROM.get(base + offset + 2 + len, crc);
+        if (crc != recordCrc(pageSeq, hdr, data, len)) break;
+
+        int8_t idx = findField(hdr[0]);
+        if (idx >= 0 && CONFIG_FIELDS[idx].size == len) {
+            memcpy((uint8_t*)&cfg + CONFIG_FIELDS[idx].offset, data, len);
+            fieldPage[idx] = page;
+        } else {
+            idx = migrateRecord(hdr[0], data, len, cfg);
+            // Сконвертированное поле будет записано в новой версии при ближайшем сохранении
+            if (idx >= 0) fieldPage[idx] = NO_PAGE;
+        }
+        offset += 2 + len + 4;
+    }
+    return offset;
+}
+
+// Формат до журнала: вся структура целиком по адресу 0 с 16-битной суммой байт
+#define LEGACY_CONFIG_MAGIC 0x4B41534B // "KASK"
+#define LEGACY_CONFIG_VERSION 4
+
+struct DeviceConfigV4 {
+    uint32_t magic;
+    uint8_t version;
+    uint32_t radio_frequency;      // Биты float, МГц
+    uint32_t radio_bandwidth;      // Биты float, кГц
+    uint8_t radio_spreadingFactor;
+    uint8_t radio_codingRate;
+    uint8_t radio_syncWord;
+    uint16_t radio_preambleLength;
+    uint32_t adc_multiplier;       // Биты float, В
+    uint32_t battery_threshold;    // Биты float, В
+    uint8_t aes_key[16];
+    uint8_t log_level;
+    int32_t relay_delay;
+    uint16_t checksum;
+};
+
+static bool loadLegacyConfig(DeviceConfig& cfg) {
+    DeviceConfigV4 old;
+    EEPROM.get(EEPROM_CONFIG_ADDR, old);
+    if (old.magic != LEGACY_CONFIG_MAGIC || old.version != LEGACY_CONFIG_VERSION) return false;
+
+    const uint8_t* data = (const uint8_t*)&old;
     uint16_t sum = 0;
-    // Считаем чексумму для всех полей кроме самого поля checksum (последние 2 байта)
-    for (size_t i = 0; i < sizeof(DeviceConfig) - 2; i++) {
+    for (size_t i = 0; i < offsetof(DeviceConfigV4, checksum); i++) {
         sum += data[i];
     }
-    return sum;
+    if (sum != old.checksum) return false;
+
+    cfg.radio_frequency = floatBitsToFixed(old.radio_frequency, 1000) * 1000;
+    cfg.radio_bandwidth = floatBitsToFixed(old.radio_bandwidth, 10);
+    cfg.radio_spreadingFactor = old.radio_spreadingFactor;
+    cfg.radio_codingRate = old.radio_codingRate;
+    cfg.radio_syncWord = old.radio_syncWord;
+    cfg.radio_preambleLength = old.radio_preambleLength;
+    cfg.adc_multiplier = floatBitsToFixed(old.adc_multiplier, 1000000);
+    cfg.battery_threshold = floatBitsToFixed(old.battery_threshold, 1000);
+    memcpy(cfg.aes_key, old.aes_key, sizeof(cfg.aes_key));
+    cfg.log_level = old.log_level;
+    cfg.relay_delay = old.relay_delay;
+    return true;
 }
 
 bool loadConfig(DeviceConfig& cfg) {
-    EEPROM.get(0, cfg);
-    
-    if (cfg.magic != CONFIG_MAGIC || cfg.version != CONFIG_VERSION) {
-        if (DEFAULT_CONFIG.log_level >= 1) Serial.println(F("Config: Magic or Version mismatch. Using defaults."));
-        cfg = DEFAULT_CONFIG;
-        return false;
+    cfg = DEFAULT_CONFIG;
+    memset(fieldPage, NO_PAGE, sizeof(fieldPage));
+    pendingFields = 0;
+
+    uint32_t seqs[CONFIG_LOG_PAGES];
+    for (uint8_t p = 0; p < CONFIG_LOG_PAGES; p++) {
+        LogPageHeader hdr;
+        EEPROM.get(pageAddr(p), hdr);
+        seqs[p] = (hdr.pageSeq != 0 && hdr.crc == pageHeaderCrc(hdr.pageSeq)) ? hdr.pageSeq : 0;
+    }
+
+    // Проигрываем страницы в порядке возрастания pageSeq, более поздние записи побеждают
+    uint32_t lastSeq = 0;
+    while (true) {
+        int8_t page = -1;
+        for (uint8_t p = 0; p < CONFIG_LOG_PAGES; p++) {
+            if (seqs[p] > lastSeq && (page < 0 || seqs[p] < seqs[page])) page = p;
+        }
+        if (page < 0) break;
+        lastSeq = seqs[page];
+        activePage = page;
+        activeSeq = lastSeq;
+        writeOffset = scanPage(page, lastSeq, cfg);
     }
-    
-    uint16_t expectedChecksum = calculateChecksum(cfg);
-    if (cfg.checksum != expectedChecksum) {
-        if (DEFAULT_CONFIG.log_level >= 1) Serial.println(F("Config: Checksum mismatch. Using defaults."));
-        cfg = DEFAULT_CONFIG;
+
+    storedConfig = cfg;
+
+    if (activeSeq == 0) {
+        // Журнал пуст: первая страница будет 1, чтобы прежний формат по адресу 0
+        // оставался целым, пока журнал не записан
+        activePage = 0;
+        writeOffset = CONFIG_LOG_PAGE_SIZE;
+
+        if (loadLegacyConfig(cfg)) {
+            if (LOG_COMPILED(1) && DEFAULT_CONFIG.log_level >= 1) Serial.println(F("Config: Migrating legacy config to log."));
+            saveConfig(cfg);
+            return true;
+        }
+        if (LOG_COMPILED(1) && DEFAULT_CONFIG.log_level >= 1) Serial.println(F("Config: No config log. Using defaults."));
         return false;
     }
-    
-    if (cfg.log_level >= 1) Serial.println(F("Config: Loaded successfully from EEPROM."));
+
+    // Перенос со следующей страницы мог оборваться вместе с питанием: завершаем его,
+    // пока исходные записи целы
+    uint8_t after = (activePage + 1) % CONFIG_LOG_PAGES;
+    for (uint8_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (fieldPage[i] == after) appendField(i);
+    }
+
+    // Поля, сконвертированные из старых версий, сразу записываем в новой
+    for (uint8_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (fieldPage[i] == NO_PAGE && memcmp((uint8_t*)&cfg + CONFIG_FIELDS[i].offset,
+                                              (const uint8_t*)&DEFAULT_CONFIG + CONFIG_FIELDS[i].offset,
+                                              CONFIG_FIELDS[i].size) != 0) {
+            saveConfig(cfg);
+            break;
+        }
+    }
+
+    if (LOG_COMPILED(1) && cfg.log_level >= 1) Serial.println(F("Config: Loaded successfully from EEPROM."));
     return true;
 }
 
 void saveConfig(DeviceConfig& cfg) {
-    cfg.magic = CONFIG_MAGIC;
-    cfg.version = CONFIG_VERSION;
-    cfg.checksum = calculateChecksum(cfg);
-    EEPROM.put(0, cfg);
-    if (cfg.log_level >= 1) Serial.println(F("Config: Saved to EEPROM."));
+    // Сначала фиксируем новые значения: перенос при смене страницы берет их из storedConfig.
+    // fieldPage измененного поля указывает на прежнюю запись до записи новой, чтобы
+    // вторая смена страницы за одно сохранение перенесла поле, а не стерла его
+    uint8_t changed = 0;
+    for (uint8_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        const ConfigField& f = CONFIG_FIELDS[i];
+        uint8_t* stored = (uint8_t*)&storedConfig + f.offset;
+        const uint8_t* cur = (const uint8_t*)&cfg + f.offset;
+        bool differs = memcmp(stored, cur, f.size) != 0;
+        if (fieldPage[i] != NO_PAGE && !differs) continue;
+        // Поля без записи (новые или сконвертированные) пишутся, но изменением не считаются
+        if (differs) {
+            memcpy(stored, cur, f.size);
+            changed++;
+        }
+        pendingFields |= 1UL << i;
+    }
+
+    // Перенос мог уже записать поле с новым значением
+    for (uint8_t i = 0; i < CONFIG_FIELD_COUNT; i++) {
+        if (pendingFields & (1UL << i)) appendField(i);
+    }
+
+    if (LOG_COMPILED(1) && cfg.log_level >= 1) {
+        Serial.print(F("Config: Saved "));
+        Serial.print(changed);
+        Serial.println(F(" field(s) to EEPROM."));
+    }
 }
@@ -0,0 +1,114 @@
+#include "energy_account.h"
+#include "config_storage.h"
+#include "sx1276_regs.h"
+#include "rtc_clock.h"
+#include "packet_debug.h"
+
+// Время в мкс: uint32 переполнился бы за 71 минуту
+static uint64_t mcuUs[MCU_STATE_COUNT];
+static uint64_t txUs;
+static uint32_t wakeups;
+static bool radioAsleep;
+static uint64_t radioSleepFromUs;   // Время контроллера (сумма состояний) на момент сна радио
+
+static McuState mcuState = MCU_RUN;
+static uint32_t stateStartUs;
+static uint32_t stopStartMs;
+static uint32_t txStartUs;
+
+void energyInit() {
+    // Время до setup() считаем работой контроллера
+    mcuUs[MCU_RUN] = micros();
+    stateStartUs = micros();
+}
+
+void energyMcuState(McuState next) {
+    uint32_t now = micros();
+    mcuUs[mcuState] += now - stateStartUs;
+    stateStartUs = now;
+    mcuState = next;
+}
+
+void energyStopBegin() {
+    energyMcuState(MCU_STOP);
+    stopStartMs = rtcNowMs();
+}
+
+void energyStopEnd() {
+    mcuUs[MCU_STOP] += (uint64_t)(rtcNowMs() - stopStartMs) * 1000;
+    // micros() после Stop продолжается с того же значения, отсчет начинаем заново
+    stateStartUs = micros();
+    mcuState = MCU_RUN;
+    wakeups++;
+}
+
+void energyTxBegin() {
+    txStartUs = micros();
+}
+
+void energyTxEnd() {
+    txUs += micros() - txStartUs;
+}
+
+void energyRadioSleep() {
+    energyMcuState(mcuState);
+    radioSleepFromUs = mcuUs[MCU_RUN] + mcuUs[MCU_UART] + mcuUs[MCU_STOP];
+    radioAsleep = true;
+}
+
+#define UA_US_PER_UAH 3600000000ULL
+
+static void printRow(Print& out, const __FlashStringHelper* name, uint64_t timeUs, uint64_t charge) {
+    out.print(name); out.print(' ');
+    out.print((uint32_t)(timeUs / 1000000)); out.print(' ');
+    out.println((uint32_t)(charge / UA_US_PER_UAH));
+}
+
+void energyPrintReport(Print& out) {
+    // Закрываем текущий отрезок, чтобы отчет включал время до команды
+    energyMcuState(mcuState);
+
+    const DeviceConfig& c = currentConfig;
+    uint64_t totalUs = mcuUs[MCU_RUN] + mcuUs[MCU_UART] + mcuUs[MCU_STOP];
+    // Сон радио - ток SX1276 ~0.2 мкА, в модели не учитывается: только время
+    uint64_t sleepUs = radioAsleep ? totalUs - radioSleepFromUs : 0;
+    uint64_t rxUs = totalUs > txUs + sleepUs ? totalUs - txUs - sleepUs : 0;
+    uint32_t txCurrent = c.current_tx + (uint32_t)c.current_tx_dbm * RADIO_TX_POWER_DBM;
+
+    // Заряд в мкА*мкс (ток current_stop задан в 0.1 мкА)
+    uint64_t stopQ = c.current_stop * mcuUs[MCU_STOP] / 10;
+    uint64_t runQ  = c.current_run * mcuUs[MCU_RUN];
+    uint64_t uartQ = c.current_uart * mcuUs[MCU_UART];
+    uint64_t rxQ   = c.current_rx * rxUs;
+    uint64_t txQ   = txCurrent * txUs;
+    uint64_t totalQ = stopQ + runQ + uartQ + rxQ + txQ;
+
+    out.println(F("state time_s uAh"));
+    printRow(out, F("stop"),   mcuUs[MCU_STOP], stopQ);
+    printRow(out, F("run"),    mcuUs[MCU_RUN], runQ);
+    printRow(out, F("uart"),   mcuUs[MCU_UART], uartQ);
+    printRow(out, F("rx"),     rxUs, rxQ);
+    printRow(out, F("tx"),     txUs, txQ);
+    printRow(out, F("rsleep"), sleepUs, 0);
+    out.print(F("wakeups ")); out.println(wakeups);
+
+    uint32_t avgUa = totalUs ? (uint32_t)(totalQ / totalUs) : 0;
+    uint32_t usedUah = (uint32_t)(totalQ / UA_US_PER_UAH);
+    // Прогноз по остатку: емкость минус уже израсходованное
+    uint32_t capacityUah = (uint32_t)c.battery_capacity * 1000;
+    uint32_t leftUah = capacityUah > usedUah ? capacityUah - usedUah : 0;
+    out.print(F("used_mAh ")); printFixedPoint((int32_t)usedUah, 1000, 3, out);
+    out.print(F(" avg_uA ")); out.print(avgUa);
+    out.print(F(" life_h "));
+    out.println(avgUa ? leftUah / avgUa : 0);
+
+    // Прием идет постоянно и от настроек почти не зависит; сравниваем то, что меняется конфигурацией
+    out.print(F("top "));
+    if (uartQ >= txQ && uartQ >= runQ) {
+        out.println(F("log"));
+    } else if (txQ >= runQ) {
+        out.println(F("relay"));
+    } else {
+        out.println(F("wake"));
+    }
+}
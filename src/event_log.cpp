@@ -0,0 +1,86 @@
+#include "event_log.h"
+#include "config_storage.h"
+#include "cobs_frame.h"
+#include "rtc_clock.h"
+
+static EventRecord events[EVENT_LOG_SIZE];
+static uint16_t eventHead = 0;   // Сквозной номер следующей записи
+static uint16_t eventCount = 0;
+
+static EventRecord& eventNext(EventId id) {
+    EventRecord& rec = events[eventHead & (EVENT_LOG_SIZE - 1)];
+    eventHead++;
+    if (eventCount < EVENT_LOG_SIZE) eventCount++;
+    memset(&rec, 0, sizeof(rec));
+    // Перевод в миллисекунды откладывается до вывода
+    rec.timestamp = rtcStamp();
+    rec.id = id;
+    return rec;
+}
+
+static void eventCommit(const EventRecord& rec) {
+    if (currentConfig.event_stream) {
+        sendFrame(FRAME_TYPE_EVENT, &rec, sizeof(rec));
+    }
+}
+
+void eventLogPacket(EventId id, const MeshHeader& header, int16_t rssi, int8_t snrQ4, uint8_t len) {
+    EventRecord& rec = eventNext(id);
+    rec.flags = header.flags;
+    rec.chanHash = header.chanHash;
+    rec.relayNode = header.relayNode;
+    rec.from = header.from;
+    rec.pktId = header.pktId;
+    rec.rssi = rssi;
+    rec.snr = snrQ4;
+    rec.len = len;
+    eventCommit(rec);
+}
+
+void eventLogSystem(EventId id, uint32_t a, uint32_t b) {
+    EventRecord& rec = eventNext(id);
+    rec.from = a;
+    rec.pktId = b;
+    eventCommit(rec);
+}
+
+static const char* const EVENT_NAMES[] = {
+    "?", "BOOT", "NEW", "DUP", "SHORT", "RXERR", "RELAY", "BUSY", "BATT", "SHUTDN", "POWER", "SKIP", "LAT", "POLICY", "FLOOD"
+};
+
+void eventLogDump(Print& out) {
+    out.print(F("events="));
+    out.println(eventCount);
+    for (uint16_t seq = eventHead - eventCount; seq != eventHead; seq++) {
+        const EventRecord& rec = events[seq & (EVENT_LOG_SIZE - 1)];
+        out.print(rtcStampToMs(rec.timestamp));
+        out.print(' ');
+        out.print(rec.id < sizeof(EVENT_NAMES) / sizeof(EVENT_NAMES[0]) ? EVENT_NAMES[rec.id] : EVENT_NAMES[0]);
+        if (rec.id >= EV_PKT_NEW && rec.id <= EV_PKT_SHORT) {
+            out.print(F(" from=0x")); out.print(rec.from, HEX);
+            out.print(F(" id=0x")); out.print(rec.pktId, HEX);
+            out.print(F(" hop=")); out.print((rec.flags >> 5) & 0x07);
+            out.print('/'); out.print(rec.flags & 0x07);
+            out.print(F(" ch=0x")); out.print(rec.chanHash, HEX);
+            out.print(F(" rssi=")); out.print(rec.rssi);
+            uint8_t snrAbs = rec.snr < 0 ? -rec.snr : rec.snr;
+            out.print(F(" snr="));
+            if (rec.snr < 0) out.print('-');
+            out.print(snrAbs / 4); out.print('.'); out.print(snrAbs % 4 * 25);
+            out.print(F(" len=")); out.print(rec.len);
+        } else if (rec.id == EV_RELAY_LATENCY) {
+            out.print(F(" delay=")); out.print(rec.from & 0xFFFF);
+            out.print(F(" busy=")); out.print(rec.from >> 16);
+            out.print(F(" proc_us=")); out.print(rec.pktId & 0xFFFF);
+            out.print(F(" air=")); out.print(rec.pktId >> 16);
+        } else if (rec.id == EV_RELAY_TX || rec.id == EV_RELAY_BUSY || rec.id == EV_RELAY_SKIP ||
+                   rec.id == EV_RELAY_POLICY || rec.id == EV_RELAY_FLOOD) {
+            out.print(F(" from=0x")); out.print(rec.from, HEX);
+            out.print(F(" id=0x")); out.print(rec.pktId, HEX);
+        } else {
+            out.print(' '); out.print(rec.from);
+            out.print(' '); out.print(rec.pktId);
+        }
+        out.println();
+    }
+}
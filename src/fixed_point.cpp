@@ -0,0 +1,68 @@
+#include "fixed_point.h"
+#include <stdlib.h>
+
+int32_t floatBitsToFixed(uint32_t bits, uint32_t scale) {
+    bool neg = bits >> 31;
+    int16_t exp = (bits >> 23) & 0xFF;
+    if (exp == 0) return 0;
+    if (exp == 0xFF) return neg ? INT32_MIN : INT32_MAX;
+
+    // value = mant * 2^(exp - 127 - 23)
+    uint64_t v = (uint64_t)((bits & 0x7FFFFF) | 0x800000) * scale;
+    int16_t shift = exp - 150;
+    if (shift >= 0) {
+        if (shift > 31 || v > ((uint64_t)INT32_MAX >> shift)) return neg ? INT32_MIN : INT32_MAX;
+        v <<= shift;
+    } else if (shift > -64) {
+        v = (v + (1ULL << (-shift - 1))) >> -shift;
+    } else {
+        v = 0;
+    }
+    if (v > INT32_MAX) v = INT32_MAX;
+    return neg ? -(int32_t)v : (int32_t)v;
+}
+
+uint32_t fixedToFloatBits(int32_t value, uint32_t scale) {
+    if (value == 0 || scale == 0) return 0;
+    uint32_t sign = value < 0 ? 0x80000000 : 0;
+    uint64_t num = value < 0 ? (uint64_t)(-(int64_t)value) : (uint64_t)value;
+    uint64_t den = scale;
+
+    // Нормализуем частное num / den в [2^23, 2^24): exp - двоичный порядок младшего бита мантиссы
+    int16_t exp = 0;
+    while (num < (den << 23)) { num <<= 1; exp--; }
+    while (num >= (den << 24)) { den <<= 1; exp++; }
+    uint32_t mant = (num + den / 2) / den;
+    if (mant >= 0x1000000) { mant >>= 1; exp++; }
+
+    return sign | (uint32_t)(exp + 150) << 23 | (mant & 0x7FFFFF);
+}
+
+bool parseFixed(const char* s, uint8_t decimals, int32_t& out) {
+    if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+        char* end;
+        out = (int32_t)strtol(s, &end, 16);
+        return end != s + 2 && *end == '\0';
+    }
+
+    bool neg = (*s == '-');
+    if (neg) s++;
+    if (*s == '\0') return false;
+
+    int32_t v = 0;
+    int8_t frac = -1;   // Число разобранных знаков после точки, -1 - точки еще не было
+    for (; *s; s++) {
+        if (*s == '.' && frac < 0) { frac = 0; continue; }
+        if (*s < '0' || *s > '9') return false;
+        if (frac >= decimals) continue;
+        if (v > (INT32_MAX - 9) / 10) return false;
+        v = v * 10 + (*s - '0');
+        if (frac >= 0) frac++;
+    }
+    for (int8_t i = frac < 0 ? 0 : frac; i < decimals; i++) {
+        if (v > INT32_MAX / 10) return false;
+        v *= 10;
+    }
+    out = neg ? -v : v;
+    return true;
+}
@@ -0,0 +1,118 @@
+#include "flood_guard.h"
+#include "config_storage.h"
+#include "preset_scan.h"
+#include "rtc_clock.h"
+
+// Строка i использует мультипликативный хэш from * FLOOD_SEEDS[i], старшие биты
+static const uint32_t FLOOD_SEEDS[FLOOD_DEPTH] = { 0x9E3779B1, 0x85EBCA77, 0xC2B2AE3D };
+
+static uint16_t sketch[FLOOD_DEPTH][FLOOD_WIDTH];
+static uint32_t totalMs;        // Сумма по всем отправителям с тем же затуханием
+static uint32_t decayedAtMs;    // Начало текущего периода затухания
+
+/**
+ * Кандидат в нарушители. Оценка не хранится: она всегда берется из sketch.
+ */
+struct FloodTop {
+    uint32_t from;              // 0 - свободная запись
+    uint16_t throttled;         // Неретранслированных пакетов (насыщается)
+};
+static FloodTop top[FLOOD_TOP_N];
+
+static inline uint8_t floodColumn(uint8_t row, uint32_t from) {
+    return (from * FLOOD_SEEDS[row]) >> (32 - FLOOD_WIDTH_BITS);
+}
+
+/**
+ * @brief Делит счетчики пополам за каждый прошедший период.
+ */
+static void floodDecay(uint32_t now) {
+    uint32_t periods = (now - decayedAtMs) / FLOOD_DECAY_MS;
+    if (periods == 0) return;
+    decayedAtMs += periods * FLOOD_DECAY_MS;
+
+    uint8_t shift = periods < 16 ? periods : 16;
+    for (uint8_t r = 0; r < FLOOD_DEPTH; r++) {
+        for (uint8_t c = 0; c < FLOOD_WIDTH; c++) sketch[r][c] >>= shift;
+    }
+    totalMs >>= shift;
+}
+
+/**
+ * @brief Оценка сверху: минимум по строкам.
+ */
+static uint16_t floodEstimate(uint32_t from) {
+    uint16_t est = 0xFFFF;
+    for (uint8_t r = 0; r < FLOOD_DEPTH; r++) {
+        uint16_t v = sketch[r][floodColumn(r, from)];
+        if (v < est) est = v;
+    }
+    return est;
+}
+
+void floodAccount(const MeshHeader& header, uint8_t len, uint8_t preset) {
+    if (header.from == 0) return;
+    floodDecay(rtcNowMs());
+
+    uint16_t airMs = (scanTimeOnAirUs(preset, len) + 500) / 1000;
+    totalMs += airMs;
+
+    // Консервативное обновление: растут только счетчики, не превышающие новую оценку.
+    // Переоценка от коллизий меньше, чем при увеличении всех строк
+    uint32_t target = (uint32_t)floodEstimate(header.from) + airMs;
+    if (target > 0xFFFF) target = 0xFFFF;
+    for (uint8_t r = 0; r < FLOOD_DEPTH; r++) {
+        uint16_t& v = sketch[r][floodColumn(r, header.from)];
+        if (v < target) v = target;
+    }
+
+    // Список кандидатов: отправитель вытесняет запись с наименьшей текущей оценкой
+    FloodTop* weakest = &top[0];
+    uint16_t weakestEst = 0xFFFF;
+    for (uint8_t i = 0; i < FLOOD_TOP_N; i++) {
+        if (top[i].from == header.from) return;
+        uint16_t est = top[i].from ? floodEstimate(top[i].from) : 0;
+        if (est < weakestEst) {
+            weakest = &top[i];
+            weakestEst = est;
+        }
+    }
+    if (target > weakestEst) {
+        weakest->from = header.from;
+        weakest->throttled = 0;
+    }
+}
+
+bool floodAllowsRelay(const MeshHeader& header, MeshPortPeek& port) {
+    if (currentConfig.flood_share == 0 || header.dest != MESH_BROADCAST_ADDR) return true;
+    floodDecay(rtcNowMs());
+    if (totalMs < FLOOD_MIN_TOTAL_MS) return true;
+    if ((uint32_t)floodEstimate(header.from) * 100 <= (uint32_t)currentConfig.flood_share * totalMs) return true;
+
+    // Широковещательные ACK (ROUTING) тоже пропускаются
+    if (meshPort(port) == PORTNUM_ROUTING) return true;
+
+    for (uint8_t i = 0; i < FLOOD_TOP_N; i++) {
+        if (top[i].from == header.from && top[i].throttled != 0xFFFF) top[i].throttled++;
+    }
+    return false;
+}
+
+void floodPrint(Print& out) {
+    floodDecay(rtcNowMs());
+    out.print(F("total_ms="));
+    out.print(totalMs);
+    out.print(F(" limit="));
+    out.print(currentConfig.flood_share);
+    out.println('%');
+    out.println(F("from air_ms share throttled"));
+    for (uint8_t i = 0; i < FLOOD_TOP_N; i++) {
+        if (top[i].from == 0) continue;
+        uint16_t est = floodEstimate(top[i].from);
+        out.print(F("0x")); out.print(top[i].from, HEX);
+        out.print(' '); out.print(est);
+        out.print(' '); out.print(totalMs ? (uint32_t)est * 100 / totalMs : 0);
+        out.print('%');
+        out.print(' '); out.println(top[i].throttled);
+    }
+}
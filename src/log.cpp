@@ -0,0 +1,47 @@
+#include "log.h"
+
+AsyncLog Log;
+uint8_t logLevelCap = 0xFF;
+
+size_t AsyncLog::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+bool AsyncLog::reserve(size_t size) {
+    if (droppedSinceNotice > 0) {
+        reportDropped();
+    }
+    if ((size_t)Serial.availableForWrite() < size) {
+        dropped += size;
+        droppedSinceNotice += size;
+        return false;
+    }
+    return true;
+}
+
+size_t AsyncLog::write(const uint8_t* buffer, size_t size) {
+    // Print::print отдает каждое значение одним вызовом, поэтому сообщение теряется целиком
+    if (!reserve(size)) return 0;
+    return Serial.write(buffer, size);
+}
+
+bool AsyncLog::pending() {
+    return Serial.availableForWrite() < SERIAL_TX_BUFFER_SIZE - 1;
+}
+
+void AsyncLog::flush() {
+    Serial.flush();
+}
+
+void AsyncLog::reportDropped() {
+    char msg[32] = "\n[log dropped ";
+    size_t len = strlen(msg);
+    utoa(droppedSinceNotice, msg + len, 10);
+    len = strlen(msg);
+    msg[len++] = ']';
+    msg[len++] = '\n';
+    if ((size_t)Serial.availableForWrite() >= len) {
+        Serial.write((const uint8_t*)msg, len);
+        droppedSinceNotice = 0;
+    }
+}
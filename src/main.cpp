@@ -18,6 +18,25 @@ TwoWire Wire2(PB14, PB13); // SDA, SCL
 #include "mesh_utils.h"
 #include "config_storage.h"
 #include "uart_config.h"
+#include "sx1276_regs.h"
+#include "log.h"
+#include "event_log.h"
+#include "rtc_clock.h"
+#include "packet_capture.h"
+#include "battery_monitor.h"
+#include "power_policy.h"
+#include "timer_service.h"
+#include "relay.h"
+#include "task_scheduler.h"
+#include "energy_account.h"
+#include "profiler.h"
+#include "stats.h"
+#include "neighbor_table.h"
+#include "relay_policy.h"
+#include "flood_guard.h"
+#include "preset_scan.h"
+#include "ram_arena.h"
+#include "telemetry.h"
 
 #define LED_PIN PA15
 
@@ -32,45 +51,110 @@ TwoWire Wire2(PB14, PB13); // SDA, SCL
 
 #define BAT_PIN PA3
 
-SX1276 radio = new Module(LORA_NSS, LORA_DIO0, LORA_RST, LORA_DIO1);
+// Модуль статический: до setup() куча не нужна вовсе
+static Module radioModule(LORA_NSS, LORA_DIO0, LORA_RST, LORA_DIO1);
+KaskaSX1276 radio = &radioModule;
 DeviceConfig currentConfig;
 
-float readBatteryVoltage() {
-  // Теперь АЦП успевает заряжаться благодаря ADC_SAMPLINGTIME в platformio.ini
-  analogReadResolution(12);
+static TimerId batteryTimer;
+static TaskId batteryTaskId;
+static TaskId rxTaskId;
 
-  // Одно чтение теперь гораздо точнее благодаря увеличению ADC_SAMPLINGTIME
-  uint32_t raw = analogRead(BAT_PIN);
+static TaskState rxThread(Task* t);
+static TaskState uartThread(Task* t);
+static TaskState batteryThread(Task* t);
 
-  // Теоретический коэффициент для делителя 1/2 и Vref 2.5V:
-  // (2.5 / 4095) * 2 = 0.00122100122
-  // Фактически при 4.01В на входе АЦП выдает raw=2288.
-  // Это означает, что реальный коэффициент составляет 4.01 / 2288 ≈ 0.00175262.
-  // Разница может быть вызвана отклонением Vref от 2.5В или погрешностью резисторов.
-  float voltage = raw * currentConfig.adc_multiplier;
+// Отметка RX-done для задержки ретрансляции; сбрасывается при чтении пакета
+static volatile uint32_t rxDoneUs;
+static volatile bool rxDoneValid = false;
 
-  if (currentConfig.log_level >= 1) {
-    Serial.print(F("\nADC Raw: "));
-    Serial.print(raw);
-    Serial.print(F(" -> "));
+// Пробуждение задач из прерывания DIO0 и таймера батареи
+static void rxWake() {
+  rxDoneUs = micros();
+  rxDoneValid = true;
+  taskSignal(rxTaskId);
+}
+static void batteryWake() { taskSignal(batteryTaskId); }
+
+/**
+ * @brief Полная инициализация радио через RadioLib (первый старт или смена конфигурации).
+ */
+static void radioFullInit() {
+  // 1. Инициализация с параметрами из конфигурации
+  int state = radio.begin(radioLibFrequency(currentConfig),
+                          radioLibBandwidth(currentConfig),
+                          currentConfig.radio_spreadingFactor,
+                          currentConfig.radio_codingRate);
+  if (state == RADIOLIB_ERR_NONE) {
+    // 2. Устанавливаем Sync Word из конфигурации
+    state = radio.setSyncWord(currentConfig.radio_syncWord);
+    
+    // 3. Устанавливаем длину преамбулы из конфигурации
+    state = radio.setPreambleLength(currentConfig.radio_preambleLength);
+
+    // 4. Опционально: CRC должен быть включен (в RadioLib по умолчанию включен)
+    state = radio.setCRC(true);
+  }
+  if (state != RADIOLIB_ERR_NONE) {
+    Serial.print(F("[RadioLib] Init failed, code "));
+    Serial.println(state);
+    while (true);
   }
 
-  return voltage;
+  // Переводим в режим приема
+  state = radio.startReceive();
+  if (state != RADIOLIB_ERR_NONE) {
+    Serial.print(F("[RadioLib] Starting to listen failed, code "));
+    Serial.println(state);
+    while (true);
+  }
 }
 
 void setup() {
+  // Сначала как можно быстрее переходим в прием: после brownout или сброса по watchdog
+  // каждая миллисекунда до startReceive() — потерянное время прослушивания эфира.
+  // Вся диагностика выводится после запуска приема.
+  // Разметка RAM не обращается к периферии: арифметика над символами компоновщика и memset.
+  arenaInit();
   Serial.setTx(PA9);
   Serial.setRx(PA10);
   Serial.begin(57600);
   
   pinMode(LED_PIN, OUTPUT);
   pinMode(BAT_PIN, INPUT_ANALOG);
+
+  // Загрузка конфигурации из EEPROM
+  bool configValid = loadConfig(currentConfig);
+
+  SPI.setSCLK(LORA_SCK);
+  SPI.setMISO(LORA_MISO);
+  SPI.setMOSI(LORA_MOSI);
+  SPI.begin();
+
+  // Быстрый путь: образ регистров из EEPROM одной пачкой по SPI.
+  // Иначе полная инициализация через RadioLib с последующим снятием образа.
+  bool fastBoot = radioImageRestore(radio, currentConfig);
+  if (!fastBoot) {
+    radioFullInit();
+  }
+  // Время от старта SysTick до входа в прием
+  uint32_t rxReadyUs = micros();
+
+  if (!fastBoot) {
+    radioImageCapture(radio, currentConfig);
+  }
+
+  // --- Отложенная инициализация и диагностика ---
   Serial.println("Debug output initialized on PA9");
 
   // Инициализация библиотеки энергосбережения
   LowPower.begin();
-  // Настройка пробуждения по прерыванию на DIO0 (RISING)
-  LowPower.attachInterruptWakeup(LORA_DIO0, NULL, RISING, DEEP_SLEEP_MODE);
+  rtcClockInit();
+  energyInit();
+  PROF_INIT();
+  eventLogSystem(EV_BOOT, rxReadyUs, fastBoot);
+  // Настройка пробуждения по прерыванию на DIO0 (RISING), обработчик будит задачу приема
+  LowPower.attachInterruptWakeup(LORA_DIO0, rxWake, RISING, DEEP_SLEEP_MODE);
   // Настройка пробуждения по UART
   LowPower.enableWakeupFrom(&Serial, NULL);
 
@@ -86,82 +170,58 @@ void setup() {
 
   Serial.println(F("Booting..."));
 
-  // Загрузка конфигурации из EEPROM
-  if (!loadConfig(currentConfig)) {
+  if (!configValid) {
     Serial.println(F("No valid config found, saving defaults..."));
     saveConfig(currentConfig);
   }
 
   // Инициализация кэша пакетов
   packetCacheInit();
-  if (currentConfig.log_level >= 1) Serial.println(F("Cache init done."));
-
-  // LoRa initialization
-  if (currentConfig.log_level >= 1) Serial.print(F("[RadioLib] Initializing ... "));
-  SPI.setSCLK(LORA_SCK);
-  SPI.setMISO(LORA_MISO);
-  SPI.setMOSI(LORA_MOSI);
-  SPI.begin();
-  // 1. Инициализация с параметрами из конфигурации
-  int state = radio.begin(currentConfig.radio_frequency,
-                          currentConfig.radio_bandwidth,
-                          currentConfig.radio_spreadingFactor,
-                          currentConfig.radio_codingRate);
-  if (state == RADIOLIB_ERR_NONE) {
-    // 2. Устанавливаем Sync Word из конфигурации
-    state = radio.setSyncWord(currentConfig.radio_syncWord);
-    
-    // 3. Устанавливаем длину преамбулы из конфигурации
-    state = radio.setPreambleLength(currentConfig.radio_preambleLength);
-
-    // 4. Опционально: CRC должен быть включен (в RadioLib по умолчанию включен)
-    state = radio.setCRC(true);
-
-    if (state == RADIOLIB_ERR_NONE) {
-        if (currentConfig.log_level >= 1) {
-            Serial.println(F("LoRa configuration applied!"));
-            Serial.print(F("Freq: ")); printFixedPoint((int32_t)(currentConfig.radio_frequency * 1000), 1000, 3); Serial.println();
-            Serial.print(F("BW: ")); printFixedPoint((int32_t)(currentConfig.radio_bandwidth * 10), 10, 1); Serial.println();
-            Serial.print(F("SF: ")); Serial.println(currentConfig.radio_spreadingFactor);
-            Serial.print(F("CR: ")); Serial.println(currentConfig.radio_codingRate);
-            Serial.print(F("Sync: 0x")); Serial.println(currentConfig.radio_syncWord, HEX);
-            Serial.print(F("Preamble: ")); Serial.println(currentConfig.radio_preambleLength);
-        }
-    }
-    if (currentConfig.log_level >= 1) Serial.println(F("success!"));
-  } else {
-    Serial.print(F("failed, code "));
-    Serial.println(state);
-    while (true);
+  if (logEnabled<1>()) {
+    Serial.println(F("Cache init done."));
+    arenaPrint(Serial);
+  }
+  policyInit();
+
+  // Задачи главного цикла; периодическая и отложенная работа будит их таймерами RTC
+  rxTaskId = taskCreate("rx", rxThread);
+  // До scanInit(): сканирование может увести радио из приема, а зерно отсрочек берется из его шума
+  relayInit(radio);
+  scanInit(radio, rxTaskId);
+  telemetryInit();
+  taskCreate("uart", uartThread);
+  batteryTaskId = taskCreate("battery", batteryThread);
+  batteryTimer = timerCreate(batteryWake);
+  timerStart(batteryTimer, 0);
+
+  if (logEnabled<1>()) {
+    Serial.print(F("[RadioLib] "));
+    Serial.print(fastBoot ? F("Fast boot from register image") : F("Full init"));
+    Serial.print(F(", RX in "));
+    Serial.print(rxReadyUs);
+    Serial.println(F(" us"));
+    Serial.print(F("Freq: ")); printFixedPoint(currentConfig.radio_frequency / 1000, 1000, 3, Serial); Serial.println();
+    Serial.print(F("BW: ")); printFixedPoint(currentConfig.radio_bandwidth, 10, 1, Serial); Serial.println();
+    Serial.print(F("SF: ")); Serial.println(currentConfig.radio_spreadingFactor);
+    Serial.print(F("CR: ")); Serial.println(currentConfig.radio_codingRate);
+    Serial.print(F("Sync: 0x")); Serial.println(currentConfig.radio_syncWord, HEX);
+    Serial.print(F("Preamble: ")); Serial.println(currentConfig.radio_preambleLength);
+    Serial.print(F("Node: !")); Serial.println(telemetryNodeNum(), HEX);
   }
 
   // Проверяем корректность
   byte version = radio.getChipVersion();
-  if (currentConfig.log_level >= 1) {
+  if (logEnabled<1>()) {
     Serial.print(F("Chip version: 0x"));
     Serial.println(version, HEX);
   }
 
-  if (version != 0x12) {
+  if (version != SX1276_CHIP_VERSION) {
     Serial.println(F("ОШИБКА: Чип не отвечает или это не SX1276!"));
   }
 
-  // Настройка дополнительных параметров (CR задается в begin, но можно уточнить)
-  // radio.setCodingRate(5); // Уже задано в begin как 4/5 (значение 5)
-
-  // Переводим в режим приема
-  if (currentConfig.log_level >= 1) Serial.print(F("[RadioLib] Starting to listen ... "));
-  state = radio.startReceive();
-  if (state == RADIOLIB_ERR_NONE) {
-    if (currentConfig.log_level >= 1) Serial.println(F("success!"));
-  } else {
-    Serial.print(F("failed, code "));
-    Serial.println(state);
-    while (true);
-  }
-
   // Print debug info
-  if (currentConfig.log_level >= 1) {
+  if (logEnabled<1>()) {
     Serial.println(F("--- RadioLib Info ---"));
     Serial.println(F("Radio Chip: SX1276"));
     Serial.print(F("NSS Pin: ")); Serial.println(LORA_NSS);
@@ -169,27 +229,45 @@ void setup() {
     Serial.print(F("RST Pin: ")); Serial.println(LORA_RST);
     Serial.println(F("---------------------"));
   }
+
+  PROF_START(PROF_AWAKE);
 }
 
-void loop() {
-  // Периодический вывод напряжения батареи
-  static unsigned long lastBatCheck = 0;
-  if (millis() - lastBatCheck > 10000 || lastBatCheck == 0) {
-    lastBatCheck = millis();
-    float vbat = readBatteryVoltage();
-    if (currentConfig.log_level >= 1) {
-        Serial.print(F("Battery Voltage: "));
-        printFixedPoint((int32_t)(vbat * 100), 100, 2);
-        Serial.println(F(" V"));
+/**
+ * @brief Плановое измерение батареи. Интервал зависит от запаса до порога.
+ */
+static void batteryCheck() {
+    uint32_t nextMs = batteryMonitorSample(rtcNowMs());
+    uint16_t vbat = batteryMillivolts();
+    if (logEnabled<1>()) {
+        eventLogSystem(EV_BATTERY, vbat, batteryRawAdc());
+    }
+    if (logEnabled<2>()) {
+        Log.print(F("\nADC Raw: "));
+        Log.print(batteryRawAdc());
+        Log.print(F(" -> Battery Voltage: "));
+        printFixedPoint(vbat, 1000, 3);
+        Log.println(F(" V"));
+    }
+
+    // Ступени энергосбережения до полного отключения
+    if (powerPolicyUpdate(vbat) && logEnabled<1>()) {
+        eventLogSystem(EV_POWER_TIER, powerTier(), vbat);
     }
 
-    if (vbat < currentConfig.battery_threshold) {
-      Serial.println(F("!!! CRITICAL BATTERY VOLTAGE !!!"));
-      Serial.println(F("Shutting down radio and entering deep sleep..."));
-      Serial.flush();
+    // Отключаемся только после нескольких измерений подряд ниже порога
+    if (batteryShutdownRequired()) {
+      Log.println(F("!!! CRITICAL BATTERY VOLTAGE !!!"));
+      Log.println(F("Shutting down radio and entering deep sleep..."));
+      eventLogSystem(EV_SHUTDOWN, vbat);
+
+      // Сохраняем кэш дубликатов, чтобы после восстановления не ретранслировать уже прошедшие пакеты
+      packetCacheSave();
+      Log.flush();
 
       // Отключаем радиомодуль
       radio.sleep();
+      energyRadioSleep();
 
       // Отключаем светодиод
       digitalWrite(LED_PIN, LOW);
@@ -197,119 +275,267 @@ void loop() {
       // Полное отключение радио и уход в цикл ожидания заряда
       while (true) {
         // Спим 1 минуту (60000 мс) для экономии энергии
+        Log.flush();
+        energyStopBegin();
         LowPower.deepSleep(60000);
+        energyStopEnd();
         
         // После просыпания проверяем напряжение
-        vbat = readBatteryVoltage();
-        Serial.print(F("Check voltage in shutdown: "));
-        printFixedPoint((int32_t)(vbat * 100), 100, 2);
-        Serial.println(F(" V"));
+        vbat = batteryMeasureMillivolts();
+        Log.print(F("Check voltage in shutdown: "));
+        printFixedPoint(vbat, 1000, 3);
+        Log.println(F(" V"));
         
         // Если напряжение поднялось выше порога + 0.1В гистерезиса, перезагружаемся
-        if (vbat > currentConfig.battery_threshold + 0.1f) {
-          Serial.println(F("Voltage recovered. Restarting..."));
-          Serial.flush();
+        if (vbat > currentConfig.battery_threshold + 100) {
+          Log.println(F("Voltage recovered. Restarting..."));
+          // Учет энергии в RAM и сбросится перезагрузкой: итог отключения печатаем сейчас
+          energyPrintReport(Log);
+          packetCacheSave();
+          Log.flush();
           HAL_NVIC_SystemReset();
         }
       }
     }
+
+    timerStart(batteryTimer, nextMs);
+}
+
+static TaskState batteryThread(Task* t) {
+  TASK_BEGIN(t);
+  for (;;) {
+    TASK_WAIT_SIGNAL(t);
+    batteryCheck();
   }
+  TASK_END(t);
+}
 
-  // Проверка команд UART
-  uartConfigLoop();
+static TaskState uartThread(Task* t) {
+  TASK_BEGIN(t);
+  for (;;) {
+    TASK_WAIT_UNTIL(t, Serial.available() > 0);
+    uartConfigLoop();
+  }
+  TASK_END(t);
+}
 
-  // Уходим в сон до прерывания на DIO0 или появления данных в Serial
-  Serial.flush();
-  digitalWrite(LED_PIN, LOW);
-  
-  // Переходим в режим Stop (deepSleep).
-  // Контроллер проснется либо по прерыванию от LoRa (DIO0), либо по входящим данным UART (Hardware Wakeup).
-  LowPower.deepSleep(60000);
+/**
+ * @brief Чтение и обработка принятого пакета.
+ */
+static void handlePacket() {
+  digitalWrite(LED_PIN, HIGH);
+  // Если фронт DIO0 пропущен и пакет найден опросом, отсчет идет от начала обработки
+  uint32_t rxUs = rxDoneValid ? rxDoneUs : micros();
+  rxDoneValid = false;
+  size_t len = radio.getPacketLength();
+  uint8_t* buffer = arenaRegion(ARENA_RX);
+
+  // Для SX127x в RadioLib используется метод readData.
+  // Флаги прерываний очищаются внутри readData автоматически.
+  PROF_START(PROF_READ);
+  int state = radio.readData(buffer, len);
+  PROF_STOP(PROF_READ);
+  STAT_INC(rxFrames);
+  // Любой кадр, даже с ошибкой, значит, что канал был занят
+  relayChannelActivity();
+  uint8_t rxPreset = scanRxPreset();
+  // Занятость канала для телеметрии: расчетное время в эфире по длине кадра на пресете приема
+  runtimeStats.rxAirtimeMs += (scanTimeOnAirUs(rxPreset, len) + 500) / 1000;
+  // Метрики последнего пакета читаем до передачи: она перезапишет регистры
+  int16_t rssi = sx1276PacketRssi(radio);
+  int8_t snrQ4 = sx1276PacketSnrQ4(radio);
+  int32_t freqError = currentConfig.capture_stream ?
+      sx1276FreqErrorHz(radio, scanPreset(rxPreset).bandwidth * 100UL) : 0;
+  CaptureVerdict verdict = CAP_NEW;
+
+  if (state == RADIOLIB_ERR_NONE && len >= 16) {
+      MeshHeader header;
+      PROF_START(PROF_PARSE);
+      parseMeshHeader(buffer, &header);
+      PROF_STOP(PROF_PARSE);
+      // Дубликаты тоже: тот же пакет от другого ретранслятора - еще одна связь
+      neighborUpdate(header, rssi, snrQ4);
+
+      PROF_START(PROF_CACHE);
+      bool isNew = addPacketToCache(header.from, header.pktId);
+      PROF_STOP(PROF_CACHE);
+
+      if (isNew) {
+          STAT_INC(rxNew);
+          floodAccount(header, len, rxPreset);
+          // log=1: только двоичная запись события (единицы мкс), текст начиная с log=2
+          if (logEnabled<1>()) {
+              eventLogPacket(EV_PKT_NEW, header, rssi, snrQ4, len);
+          }
+          if (logEnabled<2>()) {
+              Log.print(F("\nNew packet from 0x"));
+              Log.print(header.from, HEX);
+              Log.print(F(" with ID 0x"));
+              Log.println(header.pktId, HEX);
+          }
+          
+          // Логика ретрансляции. Решение принимается до подробного разбора в лог,
+          // который занимает UART надолго
+          if (currentConfig.relay_delay >= 0) {
+              // Порт читается не больше одного раза на все фильтры
+              MeshPortPeek port = {buffer, len, header, currentConfig.aes_key, MESH_PORT_NOT_READ};
+              uint16_t extraDelayMs = 0;
+              if (!policyAllowsRelay(header, port, extraDelayMs)) {
+                  verdict = CAP_POLICY_DROP;
+                  STAT_INC(relayPolicyDrop);
+                  if (logEnabled<1>()) {
+                      eventLogPacket(EV_RELAY_POLICY, header, rssi, snrQ4, len);
+                  }
+              } else if (!floodAllowsRelay(header, port)) {
+                  verdict = CAP_FLOOD;
+                  STAT_INC(relayFlood);
+                  if (logEnabled<1>()) {
+                      eventLogPacket(EV_RELAY_FLOOD, header, rssi, snrQ4, len);
+                  }
+              } else if (!powerAllowsRelay(header, port)) {
+                  verdict = CAP_POWER_SKIP;
+                  STAT_INC(relayPowerSkip);
+                  if (logEnabled<1>()) {
+                      eventLogPacket(EV_RELAY_SKIP, header, rssi, snrQ4, len);
+                  }
+              } else {
+                  RelayResult result = relaySchedule(buffer, len, header, rssi, snrQ4, rxUs, extraDelayMs);
+                  if (result == RELAY_QUEUED) {
+                      verdict = CAP_RELAYED;
+                  } else if (result != RELAY_SLOT_BUSY) {
+                      // Пакет адресован через другой узел
+                      verdict = CAP_NEXT_HOP;
+                  } else {
+                      // Предыдущий пакет еще ждет своей очереди
+                      verdict = CAP_BUSY;
+                      STAT_INC(relaySlotBusy);
+                      if (logEnabled<1>()) {
+                          eventLogPacket(EV_RELAY_BUSY, header, rssi, snrQ4, len);
+                      }
+                  }
+              }
+          }
 
-  if (digitalRead(LORA_DIO0) == HIGH) {
-    digitalWrite(LED_PIN, HIGH);
-    size_t len = radio.getPacketLength();
-    static uint8_t buffer[256]; // Используем static для уменьшения использования стека
-
-    // Для SX127x в RadioLib используется метод readData.
-    // Флаги прерываний очищаются внутри readData автоматически.
-    int state = radio.readData(buffer, len);
-
-    if (state == RADIOLIB_ERR_NONE && len >= 16) {
-        MeshHeader header;
-        parseMeshHeader(buffer, &header);
-
-        if (addPacketToCache(header.from, header.pktId)) {
-            if (currentConfig.log_level >= 1) {
-                Serial.print(F("\nNew packet from 0x"));
-                Serial.print(header.from, HEX);
-                Serial.print(F(" with ID 0x"));
-                Serial.println(header.pktId, HEX);
-            }
-            
 #ifdef ENABLE_PACKET_DEBUG
-            if (currentConfig.log_level >= 2) {
-                printPacketInsight(buffer, len, radio, header);
-            }
+          if (logEnabled<2>()) {
+              PROF_SCOPE(PROF_SERIAL);
+              printPacketInsight(buffer, len, radio, header);
+          }
 #endif
-            
-            // Логика ретрансляции
-            if (currentConfig.relay_delay >= 0) {
-                if (currentConfig.log_level >= 1) {
-                    Serial.print(F("Relay: Waiting "));
-                    Serial.print(currentConfig.relay_delay);
-                    Serial.println(F("ms..."));
-                }
-                
-                delay(currentConfig.relay_delay);
-                
-                // Проверяем эфир перед отправкой
-                // scanChannel возвращает RADIOLIB_CHANNEL_FREE если эфир чист
-                int scanState = radio.scanChannel();
-                if (scanState != RADIOLIB_CHANNEL_FREE) {
-                    if (currentConfig.log_level >= 1) {
-                        Serial.println(F("Relay: Channel busy, waiting..."));
-                    }
-                    int attempts = 0;
-                    const int maxAttempts = 100; // максимум 100 попыток (~1 секунда)
-                    while (scanState != RADIOLIB_CHANNEL_FREE && attempts < maxAttempts) {
-                        delay(10);
-                        scanState = radio.scanChannel();
-                        attempts++;
-                    }
-                }
-                if (scanState == RADIOLIB_CHANNEL_FREE) {
-                    if (currentConfig.log_level >= 1) {
-                        Serial.println(F("Relay: Sending packet (no modification)"));
-                    }
-                    radio.transmit(buffer, len);
-                    // После передачи возвращаемся в режим приема
-                    radio.startReceive();
-                } else {
-                    if (currentConfig.log_level >= 1) {
-                        Serial.println(F("Relay: Channel still busy after waiting, skipping."));
-                    }
-                }
-            }
-        } else {
-            if (currentConfig.log_level >= 1) {
-                Serial.print(F("\nDuplicate packet from 0x"));
-                Serial.print(header.from, HEX);
-                Serial.print(F(" with ID 0x"));
-                Serial.println(header.pktId, HEX);
-            }
-        }
-    } else if (state == RADIOLIB_ERR_NONE) {
-        if (currentConfig.log_level >= 1) Serial.println(F("Packet too short for Meshtastic header"));
-    }
-    
-    // Очищаем прерывания и переходим в режим ожидания нового пакета
+      } else {
+          verdict = CAP_DUP;
+          STAT_INC(rxDup);
+          relayHeardRetransmission(header);
+          if (logEnabled<1>()) {
+              eventLogPacket(EV_PKT_DUP, header, rssi, snrQ4, len);
+          }
+          if (logEnabled<2>()) {
+              Log.print(F("\nDuplicate packet from 0x"));
+              Log.print(header.from, HEX);
+              Log.print(F(" with ID 0x"));
+              Log.println(header.pktId, HEX);
+          }
+      }
+  } else if (state == RADIOLIB_ERR_NONE) {
+      verdict = CAP_SHORT;
+      STAT_INC(rxShort);
+      if (logEnabled<1>()) {
+          MeshHeader empty = {};
+          eventLogPacket(EV_PKT_SHORT, empty, rssi, snrQ4, len);
+      }
+      if (logEnabled<2>()) Log.println(F("Packet too short for Meshtastic header"));
+  } else {
+      verdict = CAP_CRC_ERROR;
+      if (state == RADIOLIB_ERR_CRC_MISMATCH) STAT_INC(rxCrcErrors); else STAT_INC(rxErrors);
+      if (logEnabled<1>()) {
+          eventLogSystem(EV_RX_ERROR, (uint32_t)state);
+      }
+  }
+
+  // Кадр захвата отправляется после решения по пакету; при ошибке CRC данные передаются как есть
+  if (state == RADIOLIB_ERR_NONE || state == RADIOLIB_ERR_CRC_MISMATCH) {
+      PROF_SCOPE(PROF_SERIAL);
+      captureFrame(buffer, len, rxPreset, rssi, snrQ4, freqError, verdict);
+  }
+
+  // Очищаем прерывания и переходим в режим ожидания нового пакета или к следующему пресету
+  if (scanActive()) {
+    scanResume();
+  } else {
     radio.startReceive();
+  }
+}
+
+static TaskState rxThread(Task* t) {
+  TASK_BEGIN(t);
+  for (;;) {
+    // Сигнал приходит из прерывания; уровень DIO0 проверяется на случай пропущенного фронта
+    TASK_WAIT_UNTIL(t, taskTakeSignal(t) || digitalRead(LORA_DIO0) == HIGH);
+    // При сканировании DIO0 сообщает и о конце CAD: пакет готов только после SCAN_PACKET
+    if (scanActive() && scanPoll() != SCAN_PACKET) continue;
+    handlePacket();
+    // Ждем пока DIO0 упадет, чтобы не прочитать тот же пакет снова
+    // (readData очищает флаги в чипе, но пин может еще мгновение быть HIGH).
+    // При сканировании следующий CAD поднимает DIO0 сам, и флаги снимает scanPoll()
+    TASK_WAIT_UNTIL(t, scanActive() || digitalRead(LORA_DIO0) == LOW);
+  }
+  TASK_END(t);
+}
 
-    // Ждем пока DIO0 упадет, чтобы не прочитать тот же пакет снова в следующем цикле loop
-    // (поскольку readData очищает флаги в чипе, но пин может еще мгновение быть HIGH)
-    while(digitalRead(LORA_DIO0) == HIGH) {
-        delay(1);
+/**
+ * @brief Причина выхода из Stop: пакет, байт по UART или будильник RTC.
+ */
+static void countWakeup() {
+  if (digitalRead(LORA_DIO0) == HIGH) {
+    STAT_INC(wakeDio0);
+  } else if (Serial.available()) {
+    STAT_INC(wakeUart);
+  } else {
+    STAT_INC(wakeTimer);
+  }
+}
+
+void loop() {
+  // Таймеры только будят задачи: измерение батареи, отложенная ретрансляция
+  timerRunDue(rtcNowMs());
+
+  // Прием, ретрансляция, UART и батарея; задачи не блокируют друг друга
+  if (taskRunAll()) return;
+
+  // Уходим в сон до прерывания на DIO0 или появления данных в Serial
+  digitalWrite(LED_PIN, LOW);
+
+  // Пока прерывание USART дописывает лог, спим в Sleep: в Stop тактирование USART остановится.
+  // Пришедший пакет важнее хвоста лога, поэтому DIO0 прерывает ожидание.
+  energyMcuState(MCU_UART);
+  while (Log.pending() && digitalRead(LORA_DIO0) == LOW) {
+    LowPower.sleep();
+  }
+  energyMcuState(MCU_RUN);
+  
+  // Переходим в режим Stop (deepSleep), если пакет еще не ждет чтения.
+  // Контроллер проснется либо по прерыванию от LoRa (DIO0), либо по входящим данным UART (Hardware Wakeup).
+  if (digitalRead(LORA_DIO0) == LOW) {
+    // Перед Stop дожидаемся последнего байта в сдвиговом регистре
+    energyMcuState(MCU_UART);
+    Log.flush();
+    energyMcuState(MCU_RUN);
+    // Спим ровно до ближайшего срока таймеров (будильник RTC работает в Stop)
+    uint32_t sleepMs = timerMsUntilNext(rtcNowMs());
+    if (sleepMs == TIMER_NONE) {
+      PROF_STOP(PROF_AWAKE);
+      energyStopBegin();
+      LowPower.deepSleep();
+      energyStopEnd();
+      countWakeup();
+      PROF_START(PROF_AWAKE);
+    } else if (sleepMs > 0) {
+      PROF_STOP(PROF_AWAKE);
+      energyStopBegin();
+      LowPower.deepSleep(sleepMs);
+      energyStopEnd();
+      countWakeup();
+      PROF_START(PROF_AWAKE);
     }
   }
 }
@@ -1,6 +1,7 @@
 #include "mesh_utils.h"
 #include <string.h>
 #include "tiny-aes.h"
+#include "profiler.h"
 
 void parseMeshHeader(const uint8_t* buffer, MeshHeader* header) {
     if (!buffer || !header) return;
@@ -14,9 +15,9 @@ void parseMeshHeader(const uint8_t* buffer, MeshHeader* header) {
     header->pktId = (uint32_t)buffer[8] | ((uint32_t)buffer[9] << 8) | ((uint32_t)buffer[10] << 16) | ((uint32_t)buffer[11] << 24);
     
     header->flags     = buffer[12];
-    // Разбор флагов
-    header->hopStart  = header->flags & 0x07;
-    header->hopLimit  = (header->flags >> 5) & 0x07;
+    // Разбор флагов: hop_limit - биты 0-2 (осталось прыжков), hop_start - биты 5-7 (было в начале)
+    header->hopLimit  = header->flags & 0x07;
+    header->hopStart  = (header->flags >> 5) & 0x07;
     header->wantAck   = (header->flags >> 3) & 0x01;
     header->viaMqtt   = (header->flags >> 4) & 0x01;
     
@@ -25,6 +26,19 @@ void parseMeshHeader(const uint8_t* buffer, MeshHeader* header) {
     header->relayNode = buffer[15];
 }
 
+void writeMeshHeader(uint8_t* buffer, const MeshHeader& header) {
+    for (uint8_t i = 0; i < 4; i++) {
+        buffer[i]     = header.dest >> (8 * i);
+        buffer[4 + i] = header.from >> (8 * i);
+        buffer[8 + i] = header.pktId >> (8 * i);
+    }
+    buffer[12] = (header.hopLimit & 0x07) | (header.wantAck << 3) | (header.viaMqtt << 4) |
+                 ((header.hopStart & 0x07) << 5);
+    buffer[13] = header.chanHash;
+    buffer[14] = header.nextHop;
+    buffer[15] = header.relayNode;
+}
+
 void initMeshtasticNonce(uint8_t *nonce, uint32_t fromNode, uint32_t packetId) {
     memset(nonce, 0, 16);
     // Nonce (16 bytes) для Meshtastic V2:
@@ -50,6 +64,7 @@ void initMeshtasticNonce(uint8_t *nonce, uint32_t fromNode, uint32_t packetId) {
 
 // Кастомная реализация CTR для Meshtastic
 void decryptMeshtasticCTR(uint8_t* buffer, size_t len, uint32_t fromNode, uint32_t packetId, const uint8_t* key) {
+    PROF_SCOPE(PROF_DECRYPT);
     uint8_t nonce[16];
     initMeshtasticNonce(nonce, fromNode, packetId);
 
@@ -83,6 +98,42 @@ void decryptMeshtasticPayload(uint8_t* buffer, size_t len, uint32_t fromNode, ui
     decryptMeshtasticCTR(buffer, len, fromNode, packetId, key);
 }
 
+void encryptMeshtasticPayload(uint8_t* buffer, size_t len, uint32_t fromNode, uint32_t packetId, const uint8_t* key) {
+    decryptMeshtasticCTR(buffer, len, fromNode, packetId, key);
+}
+
+void meshChannelKey(const MeshHeader& header, const uint8_t* baseKey, uint8_t* psk) {
+    memcpy(psk, baseKey, 16);
+    if (header.chanHash != 0x08 && header.chanHash != 0x00) {
+        psk[15] = (uint8_t)(0x01 + (header.chanHash - 0x08));
+    }
+}
+
+int16_t meshPeekPortnum(const uint8_t* buffer, size_t len, const MeshHeader& header, const uint8_t* baseKey) {
+    if (len <= 16) return -1;
+    uint8_t psk[16];
+    meshChannelKey(header, baseKey, psk);
+
+    uint8_t block[16];
+    size_t blockLen = len - 16 < sizeof(block) ? len - 16 : sizeof(block);
+    memcpy(block, buffer + 16, blockLen);
+    decryptMeshtasticCTR(block, blockLen, header.from, header.pktId, psk);
+
+    // Поле 1 (portnum), wire type 0
+    if (block[0] != 0x08) return -1;
+    uint8_t* p = block + 1;
+    size_t rem = blockLen - 1;
+    uint32_t port = pbReadVarint(&p, &rem);
+    return port <= 0x7FFF ? (int16_t)port : -1;
+}
+
+int16_t meshPort(MeshPortPeek& peek) {
+    if (peek.port == MESH_PORT_NOT_READ) {
+        peek.port = meshPeekPortnum(peek.buffer, peek.len, peek.header, peek.baseKey);
+    }
+    return peek.port;
+}
+
 // Helper to parse Varint and advance pointer safely
 uint32_t pbReadVarint(uint8_t** ptr, size_t* rem) {
     uint32_t val = 0;
@@ -113,3 +164,57 @@ void pbSkipField(uint8_t wireType, uint8_t** ptr, size_t* rem) {
         *rem = 0; // Abort on unknown wire type
     }
 }
+
+bool pbWriteVarint(uint8_t** ptr, size_t* rem, uint32_t value) {
+    uint8_t size = 1;
+    for (uint32_t v = value >> 7; v; v >>= 7) size++;
+    if (*rem < size) return false;
+    while (value >= 0x80) {
+        *(*ptr)++ = (uint8_t)value | 0x80;
+        value >>= 7;
+    }
+    *(*ptr)++ = (uint8_t)value;
+    *rem -= size;
+    return true;
+}
+
+bool pbWriteUint(uint8_t** ptr, size_t* rem, uint8_t field, uint32_t value) {
+    uint8_t* start = *ptr;
+    size_t startRem = *rem;
+    if (pbWriteVarint(ptr, rem, (uint32_t)field << 3) && pbWriteVarint(ptr, rem, value)) return true;
+    *ptr = start;
+    *rem = startRem;
+    return false;
+}
+
+bool pbWriteFixed32(uint8_t** ptr, size_t* rem, uint8_t field, uint32_t value) {
+    uint8_t* start = *ptr;
+    size_t startRem = *rem;
+    if (!pbWriteVarint(ptr, rem, (uint32_t)field << 3 | 5) || *rem < 4) {
+        *ptr = start;
+        *rem = startRem;
+        return false;
+    }
+    for (uint8_t i = 0; i < 4; i++) *(*ptr)++ = value >> (8 * i);
+    *rem -= 4;
+    return true;
+}
+
+uint8_t* pbBeginNested(uint8_t** ptr, size_t* rem, uint8_t field) {
+    uint8_t* start = *ptr;
+    size_t startRem = *rem;
+    if (!pbWriteVarint(ptr, rem, (uint32_t)field << 3 | 2) || *rem < 1) {
+        *ptr = start;
+        *rem = startRem;
+        return NULL;
+    }
+    uint8_t* lenPos = (*ptr)++;
+    (*rem)--;
+    return lenPos;
+}
+
+bool pbEndNested(uint8_t* lenPos, const uint8_t* ptr) {
+    if (!lenPos || ptr - lenPos - 1 > 0x7F) return false;
+    *lenPos = ptr - lenPos - 1;
+    return true;
+}
@@ -0,0 +1,98 @@
+#include "neighbor_table.h"
+#include "rtc_clock.h"
+
+static Neighbor neighbors[NEIGHBOR_MAX];
+
+static inline bool neighborFresh(const Neighbor& n, uint32_t now) {
+    return n.from != 0 && now - n.lastHeardMs < NEIGHBOR_MAX_AGE_MS;
+}
+
+/**
+ * @brief Скользящее среднее в 1/16 единицы.
+ *
+ * Шаг округляется к ближайшему симметрично: сдвиг отрицательной разности
+ * округлял бы вниз, и среднее сползало бы ниже измерений.
+ */
+static inline int16_t ewma(int16_t avg, int16_t sample) {
+    const int16_t half = 1 << (NEIGHBOR_EWMA_SHIFT - 1);
+    int16_t diff = sample - avg;
+    return avg + (diff >= 0 ? diff + half : diff - half) / (1 << NEIGHBOR_EWMA_SHIFT);
+}
+
+void neighborUpdate(const MeshHeader& header, int16_t rssi, int8_t snrQ4) {
+    if (header.from == 0) return;
+    uint32_t now = rtcNowMs();
+
+    Neighbor* slot = NULL;
+    Neighbor* oldest = &neighbors[0];
+    for (uint8_t i = 0; i < NEIGHBOR_MAX; i++) {
+        Neighbor& n = neighbors[i];
+        if (n.from == header.from && n.relay == header.relayNode) {
+            slot = &n;
+            break;
+        }
+        // Свободная или устаревшая запись лучше любой действующей
+        if (!neighborFresh(n, now)) {
+            if (neighborFresh(*oldest, now)) oldest = &n;
+        } else if (neighborFresh(*oldest, now) && (int32_t)(n.lastHeardMs - oldest->lastHeardMs) < 0) {
+            oldest = &n;
+        }
+    }
+
+    int16_t rssi16 = rssi * 16;
+    int16_t snr16 = snrQ4 * 4;
+    if (!slot || !neighborFresh(*slot, now)) {
+        if (!slot) slot = oldest;
+        slot->from = header.from;
+        slot->relay = header.relayNode;
+        slot->rssi = rssi16;
+        slot->snr = snr16;
+        slot->count = 0;
+    } else {
+        slot->rssi = ewma(slot->rssi, rssi16);
+        slot->snr = ewma(slot->snr, snr16);
+    }
+    slot->lastHeardMs = now;
+    if (slot->count != 0xFFFF) slot->count++;
+    // Старые прошивки не заполняют hop_start
+    slot->hops = (header.hopStart != 0 && header.hopStart >= header.hopLimit) ?
+        header.hopStart - header.hopLimit : NEIGHBOR_HOPS_UNKNOWN;
+}
+
+const Neighbor* neighborByRelay(uint8_t relay) {
+    uint32_t now = rtcNowMs();
+    const Neighbor* best = NULL;
+    for (uint8_t i = 0; i < NEIGHBOR_MAX; i++) {
+        const Neighbor& n = neighbors[i];
+        if (n.relay != relay || !neighborFresh(n, now)) continue;
+        if (!best || (int32_t)(n.lastHeardMs - best->lastHeardMs) > 0) best = &n;
+    }
+    return best;
+}
+
+/**
+ * @brief Значение в 1/16 с одним знаком после точки.
+ */
+static void printSixteenths(Print& out, int16_t v) {
+    if (v < 0) { out.print('-'); v = -v; }
+    out.print(v / 16);
+    out.print('.');
+    out.print((v % 16) * 10 / 16);
+}
+
+void neighborPrint(Print& out) {
+    uint32_t now = rtcNowMs();
+    out.println(F("from relay hops rssi snr count age_s"));
+    for (uint8_t i = 0; i < NEIGHBOR_MAX; i++) {
+        const Neighbor& n = neighbors[i];
+        if (!neighborFresh(n, now)) continue;
+        out.print(F("0x")); out.print(n.from, HEX);
+        out.print(F(" 0x")); out.print(n.relay, HEX);
+        out.print(' ');
+        if (n.hops == NEIGHBOR_HOPS_UNKNOWN) out.print('?'); else out.print(n.hops);
+        out.print(' '); printSixteenths(out, n.rssi);
+        out.print(' '); printSixteenths(out, n.snr);
+        out.print(' '); out.print(n.count);
+        out.print(' '); out.println((now - n.lastHeardMs) / 1000);
+    }
+}
@@ -1,47 +1,112 @@
 #include "packet_cache.h"
-#include <stdlib.h>
+#include <stddef.h>
+#include <EEPROM.h>
+#include "config_storage.h"
+#include "crc32.h"
+#include "rtc_clock.h"
+#include "stats.h"
+#include "ram_arena.h"
 
 // Указатель на массив структур в RAM
 static PacketId* cache = NULL;
 static size_t cacheCapacity = 0;
 static size_t currentIndex = 0;
 static size_t currentSize = 0;
+// Сквозной номер следующей вставки. Определяет позицию записи в снимке EEPROM.
+static uint32_t insertSeq = 0;
+// Номер вставки на момент последнего снимка
+static uint32_t savedSeq = 0;
 
-// Оставляем небольшой запас RAM для работы стека и других нужд (в байтах)
-#define RAM_RESERVE 2048
+// Время записи хранится не для каждого слота, а для нескольких меток по кольцу:
+// при вытеснении записи в слоте-метке известен ее возраст. Так RAM кэша не уменьшается.
+#define CACHE_AGE_MARKS 4
+static uint32_t markTime[CACHE_AGE_MARKS];
+static uint8_t markValid = 0;   // Биты меток, для которых время известно (восстановленные записи - нет)
 
-void packetCacheInit() {
-    // В STM32L051C8 8 КБ RAM. Из логов видно: used 2508 bytes from 8192 bytes.
-    // Свободно около 5684 байт.
-    // Попробуем выделить максимально возможный кусок, уменьшая размер, пока malloc не сработает.
-    
-    size_t testSize = (8192 - 2508 - RAM_RESERVE) / sizeof(PacketId);
-    
-    Serial.print(F("Starting cache allocation, target slots: "));
-    Serial.println(testSize);
-
-    while (testSize > 0) {
-        size_t bytesToAlloc = testSize * sizeof(PacketId);
-        cache = (PacketId*)malloc(bytesToAlloc);
-        if (cache != NULL) {
-            cacheCapacity = testSize;
-            memset(cache, 0, bytesToAlloc); // Обнуляем память, чтобы не ловить мусор
-            Serial.print(F("Allocated "));
-            Serial.print(bytesToAlloc);
-            Serial.println(F(" bytes."));
-            break;
-        }
-        testSize -= 10;
-        if (testSize < 10 && testSize > 0) testSize = 0;
+#define CACHE_SNAPSHOT_MAGIC 0x4B434843 // "KCHC"
+
+/**
+ * Заголовок снимка в EEPROM. Следом идут PACKET_CACHE_SNAPSHOT_SLOTS записей PacketId,
+ * запись с номером вставки seq лежит в слоте seq % PACKET_CACHE_SNAPSHOT_SLOTS.
+ */
+struct CacheSnapshotHeader {
+    uint32_t magic;
+    uint32_t headSeq;     // insertSeq на момент снимка
+    uint16_t generation;  // Счетчик снимков
+    uint16_t count;       // Количество действительных записей
+    uint32_t crc;         // CRC-32 полей выше и записей в порядке вставки
+};
+
+#define CACHE_SNAPSHOT_ENTRIES_ADDR (EEPROM_CACHE_SNAPSHOT_ADDR + sizeof(CacheSnapshotHeader))
+
+static uint16_t snapshotGeneration = 0;
+
+static uint32_t snapshotCrc(const CacheSnapshotHeader& hdr, const PacketId* entries) {
+    uint32_t crc = crc32(&hdr, offsetof(CacheSnapshotHeader, crc));
+    for (uint32_t seq = hdr.headSeq - hdr.count; seq != hdr.headSeq; seq++) {
+        crc = crc32Update(crc, &entries[seq % PACKET_CACHE_SNAPSHOT_SLOTS], sizeof(PacketId));
+    }
+    return crc;
+}
+
+/**
+ * @brief Восстанавливает записи из снимка в EEPROM в порядке вставки.
+ */
+static void packetCacheRestore() {
+    CacheSnapshotHeader hdr;
+    EEPROM.get(EEPROM_CACHE_SNAPSHOT_ADDR, hdr);
+    if (hdr.magic != CACHE_SNAPSHOT_MAGIC || hdr.count > PACKET_CACHE_SNAPSHOT_SLOTS) {
+        Serial.println(F("No cache snapshot in EEPROM."));
+        return;
+    }
+
+    // Буфер снимка временно берем из самого кэша: арена только что обнулена
+    if (cacheCapacity < 2 * PACKET_CACHE_SNAPSHOT_SLOTS) return;
+    PacketId* entries = cache + PACKET_CACHE_SNAPSHOT_SLOTS;
+    for (size_t i = 0; i < PACKET_CACHE_SNAPSHOT_SLOTS; i++) {
+        EEPROM.get(CACHE_SNAPSHOT_ENTRIES_ADDR + i * sizeof(PacketId), entries[i]);
+    }
+    if (hdr.crc != snapshotCrc(hdr, entries)) {
+        Serial.println(F("Cache snapshot CRC mismatch, ignored."));
+        memset(entries, 0, PACKET_CACHE_SNAPSHOT_SLOTS * sizeof(PacketId));
+        return;
     }
 
-    if (cache != NULL) {
-        Serial.print(F("Packet cache initialized with "));
-        Serial.print(cacheCapacity);
-        Serial.println(F(" slots."));
-    } else {
+    for (uint16_t i = 0; i < hdr.count; i++) {
+        uint32_t seq = hdr.headSeq - hdr.count + i;
+        cache[i] = entries[seq % PACKET_CACHE_SNAPSHOT_SLOTS];
+    }
+    memset(entries, 0, PACKET_CACHE_SNAPSHOT_SLOTS * sizeof(PacketId));
+
+    // Продолжаем нумерацию вставок, чтобы следующий снимок переписал только новые слоты
+    currentIndex = hdr.count;
+    currentSize = hdr.count;
+    insertSeq = savedSeq = hdr.headSeq;
+    snapshotGeneration = hdr.generation;
+
+    Serial.print(F("Restored "));
+    Serial.print(hdr.count);
+    Serial.print(F(" cache entries, snapshot gen "));
+    Serial.println(hdr.generation);
+}
+
+void packetCacheInit() {
+    // Кэш занимает всю RAM, оставшуюся в арене после фиксированных областей
+    cache = (PacketId*)arenaRegion(ARENA_CACHE);
+    cacheCapacity = arenaRegionSize(ARENA_CACHE) / sizeof(PacketId);
+
+    // Меньше одного слота на метку возраста кольцо не работает
+    if (cacheCapacity < CACHE_AGE_MARKS) {
+        cache = NULL;
+        cacheCapacity = 0;
         Serial.println(F("Failed to initialize packet cache!"));
+        return;
     }
+
+    Serial.print(F("Packet cache initialized with "));
+    Serial.print(cacheCapacity);
+    Serial.println(F(" slots."));
+    packetCacheRestore();
 }
 
 bool isPacketInCache(uint32_t senderId, uint32_t pktId) {
@@ -62,6 +127,20 @@ bool addPacketToCache(uint32_t senderId, uint32_t pktId) {
         return false;
     }
 
+    // Слот-метка: учитываем возраст вытесняемой записи и запоминаем время новой
+    if (currentIndex % (cacheCapacity / CACHE_AGE_MARKS) == 0) {
+        uint8_t mark = currentIndex / (cacheCapacity / CACHE_AGE_MARKS);
+        if (mark < CACHE_AGE_MARKS) {
+            uint32_t now = rtcNowMs();
+            if (currentSize == cacheCapacity && (markValid & (1 << mark))) {
+                statsEviction(now - markTime[mark]);
+            }
+            markTime[mark] = now;
+            markValid |= 1 << mark;
+        }
+    }
+    if (currentSize == cacheCapacity) STAT_INC(cacheEvictions);
+
     // Добавляем в кольцевой буфер
     cache[currentIndex].senderId = senderId;
     cache[currentIndex].pktId = pktId;
@@ -70,6 +149,7 @@ bool addPacketToCache(uint32_t senderId, uint32_t pktId) {
     if (currentSize < cacheCapacity) {
         currentSize++;
     }
+    insertSeq++;
 
     return true;
 }
@@ -77,3 +157,35 @@ bool addPacketToCache(uint32_t senderId, uint32_t pktId) {
 size_t getPacketCacheSize() {
     return currentSize;
 }
+
+size_t getPacketCacheCapacity() {
+    return cacheCapacity;
+}
+
+void packetCacheSave() {
+    if (cache == NULL || insertSeq == savedSeq) return;
+
+    CacheSnapshotHeader hdr;
+    hdr.magic = CACHE_SNAPSHOT_MAGIC;
+    hdr.headSeq = insertSeq;
+    hdr.generation = ++snapshotGeneration;
+    hdr.count = min(currentSize, (size_t)PACKET_CACHE_SNAPSHOT_SLOTS);
+
+    // Сначала записи, затем заголовок: при пропадании питания посередине CRC не сойдется
+    uint32_t crc = crc32(&hdr, offsetof(CacheSnapshotHeader, crc));
+    for (uint32_t seq = hdr.headSeq - hdr.count; seq != hdr.headSeq; seq++) {
+        const PacketId& entry = cache[(currentIndex + cacheCapacity - (hdr.headSeq - seq)) % cacheCapacity];
+        crc = crc32Update(crc, &entry, sizeof(PacketId));
+        // EEPROM.put пишет только изменившиеся байты, старые слоты не перезаписываются
+        EEPROM.put(CACHE_SNAPSHOT_ENTRIES_ADDR + (seq % PACKET_CACHE_SNAPSHOT_SLOTS) * sizeof(PacketId), entry);
+    }
+    hdr.crc = crc;
+    EEPROM.put(EEPROM_CACHE_SNAPSHOT_ADDR, hdr);
+    savedSeq = insertSeq;
+
+    Serial.print(F("Cache snapshot gen "));
+    Serial.print(hdr.generation);
+    Serial.print(F(": "));
+    Serial.print(hdr.count);
+    Serial.println(F(" entries saved."));
+}
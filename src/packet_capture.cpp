@@ -0,0 +1,22 @@
+#include "packet_capture.h"
+#include "config_storage.h"
+#include "cobs_frame.h"
+#include "rtc_clock.h"
+#include "preset_scan.h"
+
+void captureFrame(const uint8_t* data, uint8_t len, uint8_t preset, int16_t rssi, int8_t snrQ4, int32_t freqError, CaptureVerdict verdict) {
+    if (!currentConfig.capture_stream) return;
+
+    CaptureRecord rec;
+    rec.timestamp = rtcStamp();
+    rec.freqError = freqError;
+    const ScanPreset& p = scanPreset(preset);
+    rec.frequency = p.frequency;
+    rec.bandwidth = p.bandwidth;
+    rec.rssi = rssi;
+    rec.snr = snrQ4;
+    rec.verdict = verdict;
+    rec.preset = preset;
+    rec.sf = p.sf;
+    sendFrame(FRAME_TYPE_CAPTURE, &rec, sizeof(rec), data, len);
+}
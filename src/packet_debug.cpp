@@ -1,6 +1,10 @@
 #include "packet_debug.h"
 #include "mesh_utils.h"
 #include "config_storage.h"
+#include "preset_scan.h"
+#include "fixed_point.h"
+#include "profiler.h"
+#include "ram_arena.h"
 
 /**
  * @brief Печатает число с фиксированной точкой без использования float в Serial.print.
@@ -8,107 +12,108 @@
  * @param value Значение в виде целого числа (scaled).
  * @param divisor Делитель для получения целой части (например, 10000000 для координат).
  * @param precision Количество знаков после запятой для вывода дробной части.
+ * @param out Куда печатать (по умолчанию неблокирующий лог).
  */
-void printFixedPoint(int32_t value, int32_t divisor, int8_t precision) {
-    Serial.print(value / divisor);
-    Serial.print('.');
+void printFixedPoint(int32_t value, int32_t divisor, int8_t precision, Print& out) {
+    // Целая часть -0.xx равна нулю, знак выводим отдельно
+    if (value < 0 && value > -divisor) out.print('-');
+    out.print(value / divisor);
+    out.print('.');
     uint32_t frac = (value < 0 ? -value : value) % divisor;
     
     // Вычисляем, сколько ведущих нулей нужно добавить в дробную часть
     int32_t temp_divisor = divisor / 10;
     while (temp_divisor > 0 && frac < (uint32_t)temp_divisor && precision > 1) {
-        Serial.print('0');
+        out.print('0');
         temp_divisor /= 10;
         precision--;
     }
-    Serial.print(frac);
+    out.print(frac);
 }
 
 /**
  * @brief Печатает метку с выравниванием, двоеточием и опциональным 0x.
  */
 void printL(const __FlashStringHelper* label, bool hex_prefix = false) {
-    Serial.print(label);
+    Log.print(label);
     int16_t pad = 8 - strlen_P((const char*)label);
-    while (pad-- > 0) Serial.print(' ');
-    Serial.print(F(": "));
-    if (hex_prefix) Serial.print(F("0x"));
+    while (pad-- > 0) Log.print(' ');
+    Log.print(F(": "));
+    if (hex_prefix) Log.print(F("0x"));
 }
 
-void printPacketInsight(uint8_t* buffer, size_t len, SX1276& radio, const MeshHeader& header) {
-    Serial.println(F("\n--- [Mesh Pkt] ---"));
+void printPacketInsight(uint8_t* buffer, size_t len, KaskaSX1276& radio, const MeshHeader& header) {
+    Log.println(F("\n--- [Mesh Pkt] ---"));
 
     if (len < 16) {
-        printL(F("Pkt")); Serial.print(F("too short: ")); Serial.println(len);
+        printL(F("Pkt")); Log.print(F("too short: ")); Log.println(len);
         return;
     }
 
     // Header уже распарсен, используем переданный
 
-    printL(F("Sender"), true); Serial.println(header.from, HEX);
-    printL(F("Dest"), true);   Serial.print(header.dest, HEX);
-    if (header.dest == 0xFFFFFFFF) Serial.println(F(" (Bcast)")); else Serial.println();
-    printL(F("Pkt ID"), true); Serial.println(header.pktId, HEX);
+    printL(F("Sender"), true); Log.println(header.from, HEX);
+    printL(F("Dest"), true);   Log.print(header.dest, HEX);
+    if (header.dest == 0xFFFFFFFF) Log.println(F(" (Bcast)")); else Log.println();
+    printL(F("Pkt ID"), true); Log.println(header.pktId, HEX);
     
-    printL(F("Hop Lft")); Serial.println(header.hopStart);
-    printL(F("Hop Lim")); Serial.println(header.hopLimit);
-    printL(F("Wnt ACK")); Serial.println(header.wantAck ? 'Y' : 'N');
-    printL(F("MQTT"));    Serial.println(header.viaMqtt ? 'Y' : 'N');
+    printL(F("Hop Lft")); Log.println(header.hopLimit);
+    printL(F("Hop Strt")); Log.println(header.hopStart);
+    printL(F("Wnt ACK")); Log.println(header.wantAck ? 'Y' : 'N');
+    printL(F("MQTT"));    Log.println(header.viaMqtt ? 'Y' : 'N');
 
-    printL(F("Chan H"), true); Serial.print(header.chanHash, HEX);
+    printL(F("Chan H"), true); Log.print(header.chanHash, HEX);
     if (header.chanHash == 0x08) {
-        Serial.println(F(" (LongFast)"));
+        Log.println(F(" (LongFast)"));
     } else if (header.chanHash == 0x00) {
-        Serial.println(F(" (Routing/Ctrl)"));
+        Log.println(F(" (Routing/Ctrl)"));
     } else {
-        Serial.println(F(" (Unknown Hash!)"));
-        Serial.println(F("! Warn: Non-std hash, try key"));
+        Log.println(F(" (Unknown Hash!)"));
+        Log.println(F("! Warn: Non-std hash, try key"));
     }
-    printL(F("Nx Hop"), true); Serial.println(header.nextHop, HEX);
-    printL(F("Relay"), true);  Serial.println(header.relayNode, HEX);
+    printL(F("Nx Hop"), true); Log.println(header.nextHop, HEX);
+    printL(F("Relay"), true);  Log.println(header.relayNode, HEX);
 
-    printL(F("FreqErr")); Serial.print(radio.getFrequencyError()); Serial.println(F("Hz"));
-    printL(F("Pld Size")); Serial.print(len - 16); Serial.println();
-    printL(F("RSSI/SNR")); Serial.print(radio.getRSSI()); Serial.print(F("/")); Serial.println(radio.getSNR());
+    printL(F("FreqErr")); Log.print(sx1276FreqErrorHz(radio, scanPreset(scanRxPreset()).bandwidth * 100UL)); Log.println(F("Hz"));
+    printL(F("Pld Size")); Log.print(len - 16); Log.println();
+    printL(F("RSSI/SNR")); Log.print(sx1276PacketRssi(radio)); Log.print(F("/"));
+    printFixedPoint(sx1276PacketSnrQ4(radio) * 25, 100, 2); Log.println();
 
     // Decryption setup
     uint8_t psk[16];
-    memcpy(psk, currentConfig.aes_key, 16);
+    meshChannelKey(header, currentConfig.aes_key, psk);
 
-    if (header.chanHash != 0x08 && header.chanHash != 0x00) {
-        psk[15] = (uint8_t)(0x01 + (header.chanHash - 0x08));
-    }
-
-    static uint8_t payload[256]; // Переносим в static для экономии стека
+    uint8_t* payload = arenaRegion(ARENA_SCRATCH);
     size_t payload_len = len - 16;
-    if (payload_len > 256) payload_len = 256;
+    if (payload_len > ARENA_SCRATCH_SIZE) payload_len = ARENA_SCRATCH_SIZE;
     memcpy(payload, buffer + 16, payload_len);
     decryptMeshtasticPayload(payload, payload_len, header.from, header.pktId, psk);
 
     printL(F("Hex"));
     for(size_t i = 0; i < min((int)payload_len, 16); i++) {
-        if(payload[i] < 0x10) Serial.print('0');
-        Serial.print(payload[i], HEX); Serial.print(' ');
+        if(payload[i] < 0x10) Log.print('0');
+        Log.print(payload[i], HEX); Log.print(' ');
     }
-    if (payload_len > 16) Serial.println(F("..")); else Serial.println();
+    if (payload_len > 16) Log.println(F("..")); else Log.println();
 
     printL(F("ASCII"));
     for(size_t i = 0; i < min((int)payload_len, 32); i++) {
         uint8_t c = payload[i];
         if (c >= 32 && c <= 126) {
-            Serial.print((char)c);
+            Log.print((char)c);
         } else if (c >= 0x80) {
             // Простейшая проверка на UTF-8: если это часть многобайтовой последовательности
-            Serial.print((char)c);
+            Log.print((char)c);
         } else if (c == 0) {
-            Serial.print(F("\\0"));
+            Log.print(F("\\0"));
         } else {
-            Serial.print('.');
+            Log.print('.');
         }
     }
-    Serial.println();
+    Log.println();
 
     // Protobuf Parser (meshtastic.Data)
+    PROF_SCOPE(PROF_PROTOBUF);
     uint8_t* p = payload;
     size_t rem = payload_len;
     uint32_t portNum = 0;
@@ -122,16 +127,16 @@ void printPacketInsight(uint8_t* buffer, size_t len, SX1276& radio, const MeshHe
 
         if (field == 1 && wire == 0) { // portnum
             portNum = pbReadVarint(&p, &rem);
-            printL(F("PortNum")); Serial.print(portNum);
+            printL(F("PortNum")); Log.print(portNum);
             switch(portNum) {
-                case 1:  Serial.println(F(" (TEXT)")); break;
-                case 3:  Serial.println(F(" (POS)")); break;
-                case 4:  Serial.println(F(" (NODEINF)")); break;
-                case 67: Serial.println(F(" (TELEM)")); break;
-                case 32: Serial.println(F(" (RPLY)")); break;
-                case 5:  Serial.println(F(" (ROUTING)")); break;
-                case 70: Serial.println(F(" (STORE_FORWARD)")); break;
-                default: Serial.println(); break;
+                case 1:  Log.println(F(" (TEXT)")); break;
+                case 3:  Log.println(F(" (POS)")); break;
+                case 4:  Log.println(F(" (NODEINF)")); break;
+                case 67: Log.println(F(" (TELEM)")); break;
+                case 32: Log.println(F(" (RPLY)")); break;
+                case 5:  Log.println(F(" (ROUTING)")); break;
+                case 70: Log.println(F(" (STORE_FORWARD)")); break;
+                default: Log.println(); break;
             }
         } else if (field == 2 && wire == 2) { // payload (bytes)
             uint32_t sub_len = pbReadVarint(&p, &rem);
@@ -140,19 +145,19 @@ void printPacketInsight(uint8_t* buffer, size_t len, SX1276& radio, const MeshHe
             size_t sub_rem = sub_len;
 
             if (portNum == 1 || portNum == 32) { // TEXT or REPLY
-                printL(F("Text")); Serial.print('\"');
+                printL(F("Text")); Log.print('\"');
                 for(size_t i=0; i<sub_rem; i++) {
                     uint8_t c = sub_p[i];
                     if (c >= 32 && c < 127) {
-                        Serial.print((char)c);
+                        Log.print((char)c);
                     } else if (c >= 0x80) {
                         // UTF-8
-                        Serial.print((char)c);
+                        Log.print((char)c);
                     } else {
-                        Serial.print('.');
+                        Log.print('.');
                     }
                 }
-                Serial.println('\"');
+                Log.println('\"');
             } else if (portNum == 3) { // POSITION
                 while (sub_rem > 0) {
                     uint8_t* prev_p = sub_p;
@@ -165,7 +170,7 @@ void printPacketInsight(uint8_t* buffer, size_t len, SX1276& radio, const MeshHe
                             int32_t lat_i; memcpy(&lat_i, sub_p, 4);
                             printL(F("Lat"));
                             printFixedPoint(lat_i, 10000000, 7);
-                            Serial.println();
+                            Log.println();
                             sub_p += 4; sub_rem -= 4;
                         } else sub_rem = 0;
                     } else if (p_field == 2 && p_wire == 5) { // lon
@@ -173,12 +178,12 @@ void printPacketInsight(uint8_t* buffer, size_t len, SX1276& radio, const MeshHe
                             int32_t lon_i; memcpy(&lon_i, sub_p, 4);
                             printL(F("Lon"));
                             printFixedPoint(lon_i, 10000000, 7);
-                            Serial.println();
+                            Log.println();
                             sub_p += 4; sub_rem -= 4;
                         } else sub_rem = 0;
                     } else if (p_field == 3 && p_wire == 0) { // alt
                         int32_t alt = pbReadVarint(&sub_p, &sub_rem);
-                        printL(F("Alt")); Serial.print(alt); Serial.println('m');
+                        printL(F("Alt")); Log.print(alt); Log.println('m');
                     } else {
                         pbSkipField(p_wire, &sub_p, &sub_rem);
                     }
@@ -202,28 +207,28 @@ void printPacketInsight(uint8_t* buffer, size_t len, SX1276& radio, const MeshHe
                             d_p++; d_rem--;
                             if (d_field == 1 && d_wire == 0) {
                                 uint32_t bat = pbReadVarint(&d_p, &d_rem);
-                                printL(F("Bat")); Serial.print(bat); Serial.println('%');
+                                printL(F("Bat")); Log.print(bat); Log.println('%');
                             } else if (d_field == 2 && d_wire == 5) {
                                 if (d_rem >= 4) {
-                                    union { float f; uint32_t i; } conv;
-                                    memcpy(&conv.i, d_p, 4);
+                                    uint32_t bits;
+                                    memcpy(&bits, d_p, 4);
                                     printL(F("Volt"));
-                                    printFixedPoint((int32_t)(conv.f * 100), 100, 2);
-                                    Serial.println('V');
+                                    printFixedPoint(floatBitsToFixed(bits, 100), 100, 2);
+                                    Log.println('V');
                                     d_p += 4; d_rem -= 4;
                                 } else d_rem = 0;
                             } else if (d_field == 3 && d_wire == 5) {
                                 if (d_rem >= 4) {
-                                    union { float f; uint32_t i; } conv;
-                                    memcpy(&conv.i, d_p, 4);
+                                    uint32_t bits;
+                                    memcpy(&bits, d_p, 4);
                                     printL(F("ChUtil"));
-                                    printFixedPoint((int32_t)(conv.f * 100), 100, 2);
-                                    Serial.println('%');
+                                    printFixedPoint(floatBitsToFixed(bits, 100), 100, 2);
+                                    Log.println('%');
                                     d_p += 4; d_rem -= 4;
                                 } else d_rem = 0;
                             } else if (d_field == 5 && d_wire == 0) {
                                 uint32_t upt = pbReadVarint(&d_p, &d_rem);
-                                printL(F("Uptime")); Serial.print(upt); Serial.println('s');
+                                printL(F("Uptime")); Log.print(upt); Log.println('s');
                             } else {
                                 pbSkipField(d_wire, &d_p, &d_rem);
                             }
@@ -242,29 +247,29 @@ void printPacketInsight(uint8_t* buffer, size_t len, SX1276& radio, const MeshHe
                             e_p++; e_rem--;
                             if (e_field == 1 && e_wire == 5) {
                                 if (e_rem >= 4) {
-                                    union { float f; uint32_t i; } conv;
-                                    memcpy(&conv.i, e_p, 4);
+                                    uint32_t bits;
+                                    memcpy(&bits, e_p, 4);
                                     printL(F("Temp"));
-                                    printFixedPoint((int32_t)(conv.f * 100), 100, 2);
-                                    Serial.println('C');
+                                    printFixedPoint(floatBitsToFixed(bits, 100), 100, 2);
+                                    Log.println('C');
                                     e_p += 4; e_rem -= 4;
                                 } else e_rem = 0;
                             } else if (e_field == 2 && e_wire == 5) {
                                 if (e_rem >= 4) {
-                                    union { float f; uint32_t i; } conv;
-                                    memcpy(&conv.i, e_p, 4);
+                                    uint32_t bits;
+                                    memcpy(&bits, e_p, 4);
                                     printL(F("Humid"));
-                                    printFixedPoint((int32_t)(conv.f * 100), 100, 2);
-                                    Serial.println('%');
+                                    printFixedPoint(floatBitsToFixed(bits, 100), 100, 2);
+                                    Log.println('%');
                                     e_p += 4; e_rem -= 4;
                                 } else e_rem = 0;
                             } else if (e_field == 3 && e_wire == 5) {
                                 if (e_rem >= 4) {
-                                    union { float f; uint32_t i; } conv;
-                                    memcpy(&conv.i, e_p, 4);
+                                    uint32_t bits;
+                                    memcpy(&bits, e_p, 4);
                                     printL(F("Pres"));
-                                    printFixedPoint((int32_t)(conv.f * 100), 100, 2);
-                                    Serial.println(F("hPa"));
+                                    printFixedPoint(floatBitsToFixed(bits, 100), 100, 2);
+                                    Log.println(F("hPa"));
                                     e_p += 4; e_rem -= 4;
                                 } else e_rem = 0;
                             } else {
@@ -0,0 +1,43 @@
+#include "power_policy.h"
+#include "config_storage.h"
+#include "log.h"
+
+static PowerTier tier = PWR_FULL;
+
+/**
+ * @brief Порог перехода на ступень ниже (мВ).
+ */
+static uint16_t tierThreshold(PowerTier from) {
+    return from == PWR_FULL ? currentConfig.power_eco_threshold : currentConfig.power_critical_threshold;
+}
+
+bool powerPolicyUpdate(uint16_t millivolts) {
+    PowerTier prev = tier;
+    while (tier < PWR_CRITICAL && millivolts < tierThreshold(tier)) {
+        tier = (PowerTier)(tier + 1);
+    }
+    while (tier > PWR_FULL &&
+           millivolts > tierThreshold((PowerTier)(tier - 1)) + currentConfig.power_hysteresis) {
+        tier = (PowerTier)(tier - 1);
+    }
+    // Подробный разбор пакетов держит UART и процессор активными дольше всего
+    logLevelCap = tier == PWR_FULL ? 0xFF : 1;
+    return tier != prev;
+}
+
+PowerTier powerTier() {
+    return tier;
+}
+
+bool powerAllowsRelay(const MeshHeader& header, MeshPortPeek& port) {
+    switch (tier) {
+        case PWR_FULL:
+            return true;
+        case PWR_ECO: {
+            int16_t p = meshPort(port);
+            return p != PORTNUM_TELEMETRY && p != PORTNUM_NODEINFO;
+        }
+        default:
+            return header.dest != MESH_BROADCAST_ADDR || header.wantAck;
+    }
+}
@@ -0,0 +1,401 @@
+#include "preset_scan.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <EEPROM.h>
+#include "config_storage.h"
+#include "crc32.h"
+#include "fixed_point.h"
+#include "packet_debug.h"
+#include "rtc_clock.h"
+#include "task_scheduler.h"
+#include "timer_service.h"
+
+#define SCAN_MAGIC 0x4B53434E // "KSCN"
+
+/**
+ * Образ списка пресетов в EEPROM.
+ */
+struct ScanImage {
+    uint32_t magic;
+    ScanPreset presets[SCAN_MAX_PRESETS];
+    uint32_t crc;         // CRC-32 всех полей выше
+};
+
+/**
+ * Регистры пресета, рассчитанные при старте: перестройка сводится к записи по SPI.
+ */
+struct ScanRegs {
+    uint8_t frf[3];
+    uint8_t modemConfig1;
+    uint8_t modemConfig2;
+    uint8_t modemConfig3;
+};
+
+struct ScanStats {
+    uint32_t cad;
+    uint32_t detected;    // CAD обнаружил преамбулу
+    uint32_t received;    // Принят кадр (в том числе с ошибкой CRC)
+    uint32_t falseDetect; // После обнаружения заголовок не пришел
+};
+
+enum ScanState : uint8_t {
+    ST_OFF,
+    ST_CAD,
+    ST_RX,
+};
+
+static ScanPreset presets[SCAN_MAX_PRESETS];
+static ScanRegs regs[SCAN_MAX_PRESETS];
+static ScanStats stats[SCAN_MAX_PRESETS];
+static uint8_t readyMask;       // Пресеты, для которых при старте рассчитаны регистры
+
+static KaskaSX1276* scanRadio = NULL;
+static TimerId scanTimer = TIMER_INVALID;
+static TaskId scanTask = TASK_INVALID;
+static ScanState state = ST_OFF;
+static uint8_t current;         // Пресет текущего CAD или приема
+static uint8_t tuned = 0xFF;    // Пресет, на который настроен чип
+static uint8_t rxPreset;
+static bool headerSeen;
+
+// Длительность полного прохода по пресетам. Проходы, прерванные приемом или передачей, не учитываются
+static uint32_t cycleStartMs;
+static uint32_t cycleSumMs;
+static uint32_t cycleCount;
+static bool cycleClean;
+
+// Коды полосы RegModemConfig1 в порядке возрастания, в 0.1 кГц
+static const uint16_t BW_CODES[] = { 78, 104, 156, 208, 312, 417, 625, 1250, 2500, 5000 };
+
+static uint8_t bandwidthCode(uint16_t bandwidth) {
+    for (uint8_t i = 0; i < sizeof(BW_CODES) / sizeof(BW_CODES[0]); i++) {
+        if (BW_CODES[i] == bandwidth) return i;
+    }
+    return 0xFF;
+}
+
+static inline bool presetReady(uint8_t p) {
+    return p < SCAN_MAX_PRESETS && (readyMask & (1 << p));
+}
+
+static uint8_t nextPreset(uint8_t p) {
+    do {
+        p = (p + 1) % SCAN_MAX_PRESETS;
+    } while (!presetReady(p));
+    return p;
+}
+
+static void scanWake() {
+    taskSignal(scanTask);
+}
+
+/**
+ * @brief Рассчитывает регистры пресета от регистров основного пресета: CR, режим
+ * заголовка, CRC и AGC общие для всех.
+ */
+static bool presetRegs(uint8_t p, const uint8_t base[3]) {
+    const ScanPreset& preset = presets[p];
+    uint8_t bw = bandwidthCode(preset.bandwidth);
+    if (preset.frequency == 0 || bw == 0xFF || preset.sf < 7 || preset.sf > 12) return false;
+
+    // Frf = f * 2^19 / Fxtal, Fxtal = 32 МГц
+    uint32_t frf = ((uint64_t)preset.frequency << 19) / 32000000UL;
+    ScanRegs& r = regs[p];
+    r.frf[0] = frf >> 16;
+    r.frf[1] = frf >> 8;
+    r.frf[2] = frf;
+    r.modemConfig1 = (bw << 4) | (base[0] & 0x0F);
+    r.modemConfig2 = (preset.sf << 4) | (base[1] & 0x0F);
+    bool ldro = loraSymbolUs(preset.sf, preset.bandwidth) >= 16000;
+    r.modemConfig3 = ldro ? (base[2] | SX1276_MC3_LDRO) : (base[2] & ~SX1276_MC3_LDRO);
+    return true;
+}
+
+static void tuneRegs(uint8_t p) {
+    Module* mod = scanRadio->getMod();
+    // Частоту и параметры модема чип принимает только вне приема
+    mod->SPIwriteRegister(SX1276_REG_OP_MODE, SX1276_OP_LORA | SX1276_OP_STDBY);
+    mod->SPIwriteRegisterBurst(SX1276_REG_FRF_MSB, regs[p].frf, 3);
+    uint8_t modem[2] = { regs[p].modemConfig1, regs[p].modemConfig2 };
+    mod->SPIwriteRegisterBurst(SX1276_REG_MODEM_CONFIG1, modem, 2);
+    mod->SPIwriteRegister(SX1276_REG_MODEM_CONFIG3, regs[p].modemConfig3);
+    tuned = p;
+}
+
+static void startCad(uint8_t p) {
+    uint32_t now = rtcNowMs();
+    if (p <= current) {
+        // Новый проход
+        if (cycleClean) {
+            cycleSumMs += now - cycleStartMs;
+            cycleCount++;
+        }
+        cycleStartMs = now;
+        cycleClean = true;
+    }
+    current = p;
+    if (tuned != p) tuneRegs(p);
+    state = ST_CAD;
+    headerSeen = false;
+    scanRadio->startChannelScan();
+}
+
+/**
+ * @brief Время в мс, за которое после обнаружения должен прийти заголовок:
+ * остаток преамбулы и 8 символов заголовка с запасом в 2 символа.
+ */
+static uint32_t headerTimeoutMs(uint8_t p) {
+    uint32_t symbolUs = loraSymbolUs(presets[p].sf, presets[p].bandwidth);
+    uint64_t quarters = (uint64_t)currentConfig.radio_preambleLength * 4 + 17 + (8 + 2) * 4;
+    return (uint32_t)(quarters * symbolUs / 4000) + 1;
+}
+
+/**
+ * @brief Время в эфире кадра максимальной длины на пресете, мс.
+ */
+static uint32_t maxFrameMs(uint8_t p) {
+    return scanTimeOnAirUs(p, 255) / 1000 + 1;
+}
+
+void scanInit(KaskaSX1276& radio, TaskId rxTask) {
+    scanRadio = &radio;
+    scanTask = rxTask;
+
+    ScanImage img;
+    EEPROM.get(EEPROM_SCAN_ADDR, img);
+    if (img.magic == SCAN_MAGIC && img.crc == crc32(&img, offsetof(ScanImage, crc))) {
+        memcpy(presets, img.presets, sizeof(presets));
+    } else {
+        memset(presets, 0, sizeof(presets));
+        for (uint8_t i = 0; i < SCAN_MAX_PRESETS; i++) presets[i].bridge = SCAN_BRIDGE_SAME;
+    }
+    // Основной пресет всегда совпадает с конфигурацией радио
+    presets[0].frequency = currentConfig.radio_frequency;
+    presets[0].bandwidth = currentConfig.radio_bandwidth;
+    presets[0].sf = currentConfig.radio_spreadingFactor;
+
+    uint8_t base[3];
+    Module* mod = radio.getMod();
+    mod->SPIreadRegisterBurst(SX1276_REG_MODEM_CONFIG1, 2, base);
+    base[2] = mod->SPIreadRegister(SX1276_REG_MODEM_CONFIG3);
+
+    readyMask = 0;
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < SCAN_MAX_PRESETS; i++) {
+        if (presetRegs(i, base)) {
+            readyMask |= 1 << i;
+            count++;
+        }
+    }
+    if (!currentConfig.scan_mode || !presetReady(0) || count < 2) {
+        readyMask = presetReady(0) ? 1 : 0;
+        return;
+    }
+
+    scanTimer = timerCreate(scanWake);
+    tuned = 0;
+    current = SCAN_MAX_PRESETS - 1;
+    startCad(0);
+}
+
+void scanSave() {
+    ScanImage img;
+    img.magic = SCAN_MAGIC;
+    memcpy(img.presets, presets, sizeof(presets));
+    img.crc = crc32(&img, offsetof(ScanImage, crc));
+    // EEPROM.put перезаписывает только отличающиеся байты
+    EEPROM.put(EEPROM_SCAN_ADDR, img);
+}
+
+bool scanActive() {
+    return state != ST_OFF;
+}
+
+bool scanLocked() {
+    return state == ST_RX;
+}
+
+ScanEvent scanPoll() {
+    uint8_t irq = scanRadio->getMod()->SPIreadRegister(SX1276_REG_IRQ_FLAGS);
+
+    if (state == ST_CAD) {
+        if (!(irq & SX1276_IRQ_CAD_DONE)) return SCAN_IDLE;
+        stats[current].cad++;
+        if (irq & SX1276_IRQ_CAD_DETECTED) {
+            // Остаток преамбулы принимаем на этом же пресете
+            stats[current].detected++;
+            state = ST_RX;
+            rxPreset = current;
+            cycleClean = false;
+            scanRadio->startReceive();
+            timerStart(scanTimer, headerTimeoutMs(current));
+        } else {
+            startCad(nextPreset(current));
+        }
+        return SCAN_IDLE;
+    }
+
+    if (irq & SX1276_IRQ_RX_DONE) {
+        timerStop(scanTimer);
+        stats[rxPreset].received++;
+        return SCAN_PACKET;
+    }
+    if (timerActive(scanTimer)) return SCAN_IDLE;
+    if ((irq & SX1276_IRQ_VALID_HEADER) && !headerSeen) {
+        // Заголовок принят: ждем конца кадра максимальной длины
+        headerSeen = true;
+        timerStart(scanTimer, maxFrameMs(rxPreset));
+        return SCAN_IDLE;
+    }
+    stats[rxPreset].falseDetect++;
+    startCad(nextPreset(current));
+    return SCAN_IDLE;
+}
+
+void scanResume() {
+    if (state == ST_OFF) return;
+    timerStop(scanTimer);
+    startCad(nextPreset(current));
+}
+
+uint8_t scanRxPreset() {
+    return state == ST_OFF ? 0 : rxPreset;
+}
+
+uint8_t scanBridgeTarget(uint8_t rx) {
+    uint8_t target = presets[rx].bridge;
+    return presetReady(target) ? target : rx;
+}
+
+const ScanPreset& scanPreset(uint8_t preset) {
+    return presets[preset];
+}
+
+uint32_t scanTimeOnAirUs(uint8_t preset, uint8_t len) {
+    DeviceConfig cfg = currentConfig;
+    cfg.radio_spreadingFactor = presets[preset].sf;
+    cfg.radio_bandwidth = presets[preset].bandwidth;
+    return loraTimeOnAirUs(cfg, len);
+}
+
+void scanTune(uint8_t preset) {
+    tuneRegs(preset);
+    cycleClean = false;
+    // RadioLib считает по этим полям таймаут передачи
+    DeviceConfig cfg = currentConfig;
+    cfg.radio_frequency = presets[preset].frequency;
+    cfg.radio_bandwidth = presets[preset].bandwidth;
+    cfg.radio_spreadingFactor = presets[preset].sf;
+    scanRadio->syncModemState(cfg);
+}
+
+/**
+ * @brief Выделяет очередное поле через ',' из строки и сдвигает указатель.
+ */
+static char* nextField(char** s) {
+    char* field = *s;
+    if (!field) return NULL;
+    char* comma = strchr(field, ',');
+    if (comma) {
+        *comma = '\0';
+        *s = comma + 1;
+    } else {
+        *s = NULL;
+    }
+    return field;
+}
+
+static bool parseBridge(const char* s, uint8_t& out) {
+    if (strcmp(s, "-") == 0) {
+        out = SCAN_BRIDGE_SAME;
+        return true;
+    }
+    int32_t v;
+    if (!parseFixed(s, 0, v) || v < 0 || v >= SCAN_MAX_PRESETS) return false;
+    out = (uint8_t)v;
+    return true;
+}
+
+bool scanSet(const char* spec) {
+    char buf[40];
+    if (strlen(spec) >= sizeof(buf)) return false;
+    strcpy(buf, spec);
+    char* rest = buf;
+
+    int32_t index;
+    char* field = nextField(&rest);
+    if (!parseFixed(field, 0, index) || index < 0 || index >= SCAN_MAX_PRESETS) return false;
+    field = nextField(&rest);
+    if (!field) return false;
+
+    ScanPreset p = presets[index];
+    if (index == 0) {
+        // Частота и модуляция основного пресета задаются параметрами freq, sf, bw
+        if (!parseBridge(field, p.bridge)) return false;
+    } else if (strcmp(field, "-") == 0) {
+        memset(&p, 0, sizeof(p));
+        p.bridge = SCAN_BRIDGE_SAME;
+    } else {
+        int32_t freq, sf, bw;
+        if (!parseFixed(field, 6, freq) || freq < 137000000 || freq > 1020000000) return false;
+        field = nextField(&rest);
+        if (!field || !parseFixed(field, 0, sf) || sf < 7 || sf > 12) return false;
+        field = nextField(&rest);
+        if (!field || !parseFixed(field, 1, bw) || bandwidthCode(bw) == 0xFF) return false;
+        p.frequency = freq;
+        p.sf = sf;
+        p.bandwidth = bw;
+        p.bridge = SCAN_BRIDGE_SAME;
+        field = nextField(&rest);
+        if (field && !parseBridge(field, p.bridge)) return false;
+    }
+    if (rest) return false;
+    presets[index] = p;
+    return true;
+}
+
+/**
+ * @brief Доля пропущенных преамбул, %: CAD пресета повторяется раз в проход, и пакет
+ * теряется, если за остаток преамбулы после CAD приемник не успевает его захватить.
+ */
+static uint32_t missPercent(uint8_t p, uint32_t cycleUs) {
+    uint32_t symbolUs = loraSymbolUs(presets[p].sf, presets[p].bandwidth);
+    uint64_t preambleUs = ((uint64_t)currentConfig.radio_preambleLength * 4 + 17) * symbolUs / 4;
+    uint32_t needUs = symbolUs * (SCAN_CAD_SYMBOLS + SCAN_LOCK_SYMBOLS);
+    uint64_t usableUs = preambleUs > needUs ? preambleUs - needUs : 0;
+    if (usableUs >= cycleUs) return 0;
+    return (uint32_t)((cycleUs - usableUs) * 100 / cycleUs);
+}
+
+void scanPrint(Print& out) {
+    out.print(F("scan="));
+    out.print(scanActive() ? 1 : 0);
+    out.print(F(" cycle_ms="));
+    uint32_t cycleUs = 0;
+    if (cycleCount) {
+        cycleUs = (uint32_t)((uint64_t)cycleSumMs * 1000 / cycleCount);
+        printFixedPoint(cycleUs / 100, 10, 1, out);
+        out.println();
+    } else {
+        out.println('?');
+    }
+    out.println(F("n freq sf bw bridge cad det rx false miss%"));
+    for (uint8_t i = 0; i < SCAN_MAX_PRESETS; i++) {
+        const ScanPreset& p = presets[i];
+        if (p.frequency == 0) continue;
+        out.print(i);
+        out.print(' '); printFixedPoint(p.frequency / 1000, 1000, 3, out);
+        out.print(' '); out.print(p.sf);
+        out.print(' '); printFixedPoint(p.bandwidth, 10, 1, out);
+        out.print(' ');
+        if (p.bridge == SCAN_BRIDGE_SAME) out.print('-'); else out.print(p.bridge);
+        const ScanStats& s = stats[i];
+        out.print(' '); out.print(s.cad);
+        out.print(' '); out.print(s.detected);
+        out.print(' '); out.print(s.received);
+        out.print(' '); out.print(s.falseDetect);
+        out.print(' ');
+        if (scanActive() && cycleCount && presetReady(i)) out.println(missPercent(i, cycleUs));
+        else out.println('?');
+    }
+}
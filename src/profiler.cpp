@@ -0,0 +1,95 @@
+#include "profiler.h"
+
+#ifdef ENABLE_PROFILER
+
+#include "packet_debug.h"
+
+// Участок короче этого меряется по TIM22 (16 бит: при 32 МГц переполнение через 2 мс)
+#define PROF_TICK_LIMIT_US 1000
+
+struct ProfStats {
+    uint32_t count;
+    uint64_t sumTicks;
+    uint32_t minTicks;
+    uint32_t maxTicks;
+    uint16_t hist[PROF_HIST_BUCKETS];   // Насыщаются на 0xFFFF
+    uint32_t startUs;
+    uint16_t startTick;
+};
+
+static ProfStats stats[PROF_STAGE_COUNT];
+
+static const char* const STAGE_NAMES[PROF_STAGE_COUNT] = {
+    "awake", "read", "parse", "cache", "decrypt", "protobuf", "serial", "cad", "tx",
+};
+
+static inline uint32_t ticksPerUs() {
+    return SystemCoreClock / 1000000;
+}
+
+void profInit() {
+    // TIM22 на APB2 без делителя: один тик - один такт ядра
+    __HAL_RCC_TIM22_CLK_ENABLE();
+    TIM22->PSC = 0;
+    TIM22->ARR = 0xFFFF;
+    TIM22->EGR = TIM_EGR_UG;
+    TIM22->CR1 = TIM_CR1_CEN;
+
+    for (uint8_t i = 0; i < PROF_STAGE_COUNT; i++) {
+        stats[i].minTicks = UINT32_MAX;
+    }
+}
+
+void profStart(ProfStage stage) {
+    ProfStats& s = stats[stage];
+    s.startUs = micros();
+    s.startTick = (uint16_t)TIM22->CNT;   // Последним, чтобы не учитывать micros()
+}
+
+void profStop(ProfStage stage) {
+    uint16_t tick = (uint16_t)TIM22->CNT;
+    ProfStats& s = stats[stage];
+    uint32_t us = micros() - s.startUs;
+    uint32_t ticks = us < PROF_TICK_LIMIT_US ? (uint16_t)(tick - s.startTick) : us * ticksPerUs();
+
+    s.count++;
+    s.sumTicks += ticks;
+    if (ticks < s.minTicks) s.minTicks = ticks;
+    if (ticks > s.maxTicks) s.maxTicks = ticks;
+
+    uint32_t whole = ticks / ticksPerUs();
+    uint8_t bucket = whole ? 32 - __builtin_clz(whole) : 0;
+    if (bucket >= PROF_HIST_BUCKETS) bucket = PROF_HIST_BUCKETS - 1;
+    if (s.hist[bucket] != 0xFFFF) s.hist[bucket]++;
+}
+
+/**
+ * @brief Тики в мкс с двумя знаками.
+ */
+static void printTicks(Print& out, uint64_t ticks) {
+    printFixedPoint((int32_t)(ticks * 100 / ticksPerUs()), 100, 2, out);
+}
+
+void profPrint(Print& out) {
+    out.println(F("stage count min_us avg_us max_us | log2 us histogram"));
+    for (uint8_t i = 0; i < PROF_STAGE_COUNT; i++) {
+        const ProfStats& s = stats[i];
+        if (s.count == 0) continue;
+        out.print(STAGE_NAMES[i]); out.print(' ');
+        out.print(s.count); out.print(' ');
+        printTicks(out, s.minTicks); out.print(' ');
+        printTicks(out, s.sumTicks / s.count); out.print(' ');
+        printTicks(out, s.maxTicks);
+        out.print(F(" |"));
+        // Пустые корзины в хвосте не выводим
+        uint8_t last = PROF_HIST_BUCKETS;
+        while (last > 0 && s.hist[last - 1] == 0) last--;
+        for (uint8_t b = 0; b < last; b++) {
+            out.print(' ');
+            out.print(s.hist[b]);
+        }
+        out.println();
+    }
+}
+
+#endif // ENABLE_PROFILER
@@ -0,0 +1,101 @@
+#include "ram_arena.h"
+#include <errno.h>
+#include <stddef.h>
+
+// Символы скрипта компоновщика STM32duino. _Min_Stack_Size абсолютный: значение - его адрес
+extern "C" char _sdata;           // Начало RAM (.data лежит первой)
+extern "C" char _end;             // Конец .bss, отсюда растет куча
+extern "C" char _estack;          // Вершина стека, конец RAM
+extern "C" char _Min_Stack_Size;
+
+#define ARENA_ALIGN(p) ((uint8_t*)(((uintptr_t)(p) + 7) & ~(uintptr_t)7))
+
+static const uint16_t FIXED_SIZES[ARENA_CACHE] = { ARENA_RX_SIZE, ARENA_TX_SIZE, ARENA_SCRATCH_SIZE };
+static const char* const REGION_NAMES[ARENA_REGION_COUNT] = { "rx", "tx", "scratch", "cache" };
+
+// Границы областей: область i занимает [bounds[i], bounds[i + 1])
+static uint8_t* bounds[ARENA_REGION_COUNT + 1];
+
+static uint8_t* heapTop = (uint8_t*)&_end;
+
+static inline uint8_t* arenaBase() {
+    return ARENA_ALIGN(&_end + ARENA_HEAP_RESERVE);
+}
+
+static inline uint8_t* stackLimit() {
+    return (uint8_t*)((uintptr_t)(&_estack - (uintptr_t)&_Min_Stack_Size) & ~(uintptr_t)7);
+}
+
+/**
+ * @brief Замена _sbrk ядра: куча не заходит в арену. Без этого malloc RadioLib
+ * мог бы выделить память поверх кэша, а не вернуть ошибку.
+ */
+extern "C" void* _sbrk(ptrdiff_t incr) {
+    uint8_t* prev = heapTop;
+    if (heapTop + incr > arenaBase()) {
+        errno = ENOMEM;
+        return (void*)-1;
+    }
+    heapTop += incr;
+    return prev;
+}
+
+void arenaInit() {
+    uint8_t* p = arenaBase();
+    for (uint8_t i = 0; i < ARENA_CACHE; i++) {
+        bounds[i] = p;
+        p += FIXED_SIZES[i];
+    }
+    // Последние 8 байт перед стеком - слово-сторож (8 для выравнивания)
+    uint8_t* end = stackLimit() - 8;
+    bounds[ARENA_CACHE] = p;
+    bounds[ARENA_REGION_COUNT] = end > p ? end : p;
+
+    memset(bounds[0], 0, bounds[ARENA_REGION_COUNT] - bounds[0]);
+    *(uint32_t*)bounds[ARENA_REGION_COUNT] = ARENA_GUARD_WORD;
+
+    // Свободный стек ниже текущей вершины; запас 64 байта под кадр самого memset
+    uint8_t* sp = (uint8_t*)(uintptr_t)__get_MSP() - 64;
+    uint8_t* fillFrom = bounds[ARENA_REGION_COUNT] + 8;
+    if (sp > fillFrom) memset(fillFrom, ARENA_STACK_FILL, sp - fillFrom);
+}
+
+uint8_t* arenaRegion(ArenaRegion region) {
+    return bounds[region];
+}
+
+size_t arenaRegionSize(ArenaRegion region) {
+    return bounds[region + 1] - bounds[region];
+}
+
+/**
+ * @brief Максимальная глубина стека с момента arenaInit(): первый затертый байт заполнителя.
+ */
+static size_t arenaStackPeak() {
+    uint8_t* p = bounds[ARENA_REGION_COUNT] + 8;
+    while (p < (uint8_t*)&_estack && *p == ARENA_STACK_FILL) p++;
+    return (uint8_t*)&_estack - p;
+}
+
+static void printShare(Print& out, const char* name, size_t bytes, size_t total) {
+    out.print(name); out.print(' ');
+    out.print(bytes); out.print(' ');
+    out.print(bytes * 100 / total); out.println('%');
+}
+
+void arenaPrint(Print& out) {
+    size_t total = &_estack - &_sdata;
+    printShare(out, "static", &_end - &_sdata, total);
+    printShare(out, "heap", arenaBase() - (uint8_t*)&_end, total);
+    for (uint8_t i = 0; i < ARENA_REGION_COUNT; i++) {
+        printShare(out, REGION_NAMES[i], arenaRegionSize((ArenaRegion)i), total);
+    }
+    printShare(out, "stack", (uint8_t*)&_estack - bounds[ARENA_REGION_COUNT], total);
+
+    out.print(F("heap_peak="));
+    out.print(heapTop - (uint8_t*)&_end);
+    out.print(F(" stack_peak="));
+    out.print(arenaStackPeak());
+    out.print(F(" guard="));
+    out.println(*(uint32_t*)bounds[ARENA_REGION_COUNT] == ARENA_GUARD_WORD ? F("ok") : F("BROKEN"));
+}
@@ -0,0 +1,335 @@
+#include "relay.h"
+#include "config_storage.h"
+#include "timer_service.h"
+#include "task_scheduler.h"
+#include "event_log.h"
+#include "log.h"
+#include "energy_account.h"
+#include "profiler.h"
+#include "stats.h"
+#include "rtc_clock.h"
+#include "preset_scan.h"
+#include "ram_arena.h"
+#include "neighbor_table.h"
+#include "crc32.h"
+
+// Пакет, ожидающий ретрансляции
+static struct {
+    uint8_t* data;      // Область ARENA_TX
+    uint8_t len;
+    MeshHeader header;
+    int16_t rssi;
+    int8_t snrQ4;
+    uint8_t attempts;   // Проверок канала
+    bool quietServed;   // Канал был свободен в начале текущей отсрочки, и кадров за нее не было
+    bool busy;          // Слот занят от relaySchedule() до отправки или отказа
+    bool fallback;      // Запасной повтор за назначенный next hop
+    bool own;           // Собственный пакет (телеметрия), а не ретрансляция
+    uint8_t preset;     // Пресет передачи при сканировании (мост между пресетами)
+    // Отметки для гистограмм задержки: micros() там, где нет сна, и rtcNowMs() через Stop
+    uint32_t rxDoneUs;
+    uint32_t queuedUs;
+    uint32_t queuedMs;
+    uint32_t firstCheckMs;
+} pending;
+
+// Составляющие задержки ретрансляции, гистограммы по log2 мкс
+enum LatencyStage : uint8_t {
+    LAT_PROC,   // От RX-done (DIO0) до постановки в очередь: SPI и обработка
+    LAT_DELAY,  // От очереди до первой проверки канала: relay_delay
+    LAT_BUSY,   // Ожидание свободного канала и случайная отсрочка
+    LAT_AIR,    // От свободного канала до TX-done
+    LAT_TOTAL,
+    LAT_STAGE_COUNT
+};
+
+static uint16_t latHist[LAT_STAGE_COUNT][RELAY_LAT_BUCKETS];   // Насыщаются на 0xFFFF
+static uint32_t latMaxUs[LAT_STAGE_COUNT];
+
+static void latencyAdd(LatencyStage stage, uint32_t us) {
+    uint8_t bucket = us ? 32 - __builtin_clz(us) : 0;
+    if (bucket >= RELAY_LAT_BUCKETS) bucket = RELAY_LAT_BUCKETS - 1;
+    if (latHist[stage][bucket] != 0xFFFF) latHist[stage][bucket]++;
+    if (us > latMaxUs[stage]) latMaxUs[stage] = us;
+}
+
+static inline uint16_t sat16(uint32_t v) {
+    return v > 0xFFFF ? 0xFFFF : (uint16_t)v;
+}
+
+/**
+ * @brief Учитывает составляющие задержки отправленного пакета.
+ */
+static void latencyRecord(uint32_t clearMs, uint32_t airUs) {
+    uint32_t procUs = pending.queuedUs - pending.rxDoneUs;
+    uint32_t delayMs = pending.firstCheckMs - pending.queuedMs;
+    uint32_t busyMs = clearMs - pending.firstCheckMs;
+
+    latencyAdd(LAT_PROC, procUs);
+    latencyAdd(LAT_DELAY, delayMs * 1000);
+    latencyAdd(LAT_BUSY, busyMs * 1000);
+    latencyAdd(LAT_AIR, airUs);
+    latencyAdd(LAT_TOTAL, procUs + (delayMs + busyMs) * 1000 + airUs);
+
+    if (logEnabled<1>()) {
+        eventLogSystem(EV_RELAY_LATENCY, sat16(delayMs) | (uint32_t)sat16(busyMs) << 16,
+                       sat16(procUs) | (uint32_t)sat16(airUs / 1000) << 16);
+    }
+}
+
+static KaskaSX1276* relayRadio = NULL;
+static TimerId relayTimer = TIMER_INVALID;
+static TaskId relayTaskId = TASK_INVALID;
+
+static void relayWake() {
+    taskSignal(relayTaskId);
+}
+
+/**
+ * @brief Возвращает радио к приему или к сканированию пресетов.
+ */
+static void relayResumeRx(KaskaSX1276& radio) {
+    if (scanActive()) {
+        scanResume();
+    } else {
+        radio.startReceive();
+    }
+}
+
+/**
+ * @brief Занят ли канал прямо сейчас.
+ *
+ * Радио и так принимает на пресете передачи, поэтому CAD не нужен: достаточно
+ * прочитать RegModemStat (модем обнаружил преамбулу, синхронизировался или принял
+ * заголовок) и мгновенный RSSI. При сканировании радио слушает другие пресеты,
+ * и канал проверяется через CAD на пресете передачи.
+ */
+static bool relayChannelBusy(KaskaSX1276& radio) {
+    if (scanActive()) {
+        scanTune(pending.preset);
+        bool busy = radio.scanChannel() != RADIOLIB_CHANNEL_FREE;
+        scanResume();
+        return busy;
+    }
+    Module* mod = radio.getMod();
+    if (mod->SPIreadRegister(SX1276_REG_MODEM_STAT) & SX1276_MODEM_STAT_BUSY) return true;
+    return currentConfig.lbt_rssi != 0 && sx1276CurrentRssi(radio) > currentConfig.lbt_rssi;
+}
+
+/**
+ * @brief Случайная отсрочка перед передачей, мс: 1..RELAY_LBT_SLOTS слотов по символам пресета передачи.
+ */
+static uint32_t relayBackoffMs() {
+    const ScanPreset& tx = scanPreset(pending.preset);
+    uint32_t slotUs = loraSymbolUs(tx.sf, tx.bandwidth) * RELAY_LBT_SLOT_SYMBOLS;
+    uint32_t slotMs = (slotUs + 999) / 1000;
+    return slotMs * random(1, RELAY_LBT_SLOTS + 1);
+}
+
+/**
+ * @brief Шаг listen-before-talk: передает, если канал свободен и отсрочка выдержана.
+ *
+ * Между проверками контроллер спит. Кадр, принятый за время отсрочки (DIO0),
+ * сбрасывает ее через relayChannelActivity().
+ *
+ * @return true если попытка завершена (отправлено или отказ), false - повторить через relayBackoffMs()
+ */
+static bool relayAttempt() {
+    KaskaSX1276& radio = *relayRadio;
+
+    // Сканер принимает пакет: радио занято, проверка не засчитывается
+    if (scanLocked()) return false;
+
+    uint32_t now = rtcNowMs();
+    if (pending.attempts == 0) pending.firstCheckMs = now;
+    if (pending.attempts != 0xFF) pending.attempts++;
+    PROF_START(PROF_CAD);
+    bool busy = relayChannelBusy(radio);
+    PROF_STOP(PROF_CAD);
+    STAT_INC(cadAttempts);
+    if (busy) STAT_INC(cadBusy);
+
+    if (busy || !pending.quietServed) {
+        // Канал занят или только что освободился: выжидаем новую случайную паузу
+        pending.quietServed = !busy;
+        if (now - pending.firstCheckMs < RELAY_LBT_MAX_WAIT_MS) {
+            if (busy && logEnabled<2>()) {
+                Log.println(F("Relay: Channel busy, waiting..."));
+            }
+            return false;
+        }
+        STAT_INC(relayChannelBusy);
+        if (logEnabled<1>()) {
+            eventLogPacket(EV_RELAY_BUSY, pending.header, pending.rssi, pending.snrQ4, pending.len);
+        }
+        if (logEnabled<2>()) {
+            Log.println(F("Relay: Channel still busy after waiting, skipping."));
+        }
+        return true;
+    }
+
+    if (pending.fallback) STAT_INC(nextHopFallback);
+    if (logEnabled<2>()) {
+        Log.println(pending.own ? F("Relay: Sending own packet") : F("Relay: Sending packet (no modification)"));
+    }
+    if (scanActive()) scanTune(pending.preset);
+    uint32_t txStartUs = micros();
+    energyTxBegin();
+    PROF_START(PROF_TX);
+    radio.transmit(pending.data, pending.len);
+    PROF_STOP(PROF_TX);
+    energyTxEnd();
+    uint32_t airUs = micros() - txStartUs;
+    runtimeStats.txAirtimeMs += airUs / 1000;
+    if (pending.own) {
+        STAT_INC(telemetrySent);
+    } else {
+        STAT_INC(relayed);
+        if (logEnabled<1>()) {
+            eventLogPacket(EV_RELAY_TX, pending.header, pending.rssi, pending.snrQ4, pending.len);
+        }
+        latencyRecord(now, airUs);
+    }
+    // После передачи возвращаемся в режим приема
+    relayResumeRx(radio);
+    return true;
+}
+
+/**
+ * @brief Задача ретрансляции: ждет срока relay_delay, затем свободного канала.
+ */
+static TaskState relayThread(Task* t) {
+    TASK_BEGIN(t);
+    for (;;) {
+        TASK_WAIT_SIGNAL(t);
+        if (relayAttempt()) {
+            pending.busy = false;
+        } else {
+            timerStart(relayTimer, relayBackoffMs());
+        }
+    }
+    TASK_END(t);
+}
+
+void relayChannelActivity() {
+    if (pending.busy && pending.quietServed) {
+        pending.quietServed = false;
+        STAT_INC(lbtRestart);
+    }
+}
+
+void relayInit(KaskaSX1276& radio) {
+    relayRadio = &radio;
+    pending.data = arenaRegion(ARENA_TX);
+    // Шум широкополосного RSSI - источник случайности для отсрочек разных узлов.
+    // Уникальный ID контроллера различает узлы, даже если шум прочитался плохо
+    uint32_t uid[3] = { HAL_GetUIDw0(), HAL_GetUIDw1(), HAL_GetUIDw2() };
+    randomSeed(sx1276RandomSeed(radio) ^ crc32(uid, sizeof(uid)));
+    relayTimer = timerCreate(relayWake);
+    relayTaskId = taskCreate("relay", relayThread);
+}
+
+RelayResult relaySchedule(const uint8_t* buffer, uint8_t len, const MeshHeader& header, int16_t rssi, int8_t snrQ4,
+                          uint32_t rxDoneUs, uint16_t extraDelayMs) {
+    // 0 в nextHop - назначения нет, пакет идет заливкой
+    bool designated = header.nextHop == 0 ||
+                      (currentConfig.relay_id != 0 && header.nextHop == currentConfig.relay_id);
+    if (!designated && currentConfig.next_hop_timeout == 0) return RELAY_SUPPRESSED;
+
+    // Запасной повтор уступает слот обязательному, пока его таймер еще не сработал
+    if (pending.busy && !(designated && pending.fallback && timerActive(relayTimer))) {
+        return RELAY_SLOT_BUSY;
+    }
+
+    pending.rxDoneUs = rxDoneUs;
+    pending.queuedUs = micros();
+    pending.queuedMs = rtcNowMs();
+
+    memcpy(pending.data, buffer, len);
+    pending.len = len;
+    pending.header = header;
+    pending.rssi = rssi;
+    pending.snrQ4 = snrQ4;
+    pending.attempts = 0;
+    pending.quietServed = false;
+    pending.busy = true;
+    pending.fallback = !designated;
+    pending.own = false;
+    pending.preset = scanBridgeTarget(scanRxPreset());
+
+    // Next hop, которого мы давно не слышали, вряд ли повторит пакет: запасной повтор
+    // уходит через relay_delay, не дожидаясь next_hop_timeout
+    bool waitNextHop = !designated && neighborByRelay(header.nextHop) != NULL;
+    uint32_t delayMs = (waitNextHop ? currentConfig.next_hop_timeout : currentConfig.relay_delay) + extraDelayMs;
+    if (logEnabled<2>()) {
+        Log.print(designated ? F("Relay: Waiting ") : F("Relay: Next hop 0x"));
+        if (!designated) {
+            Log.print(header.nextHop, HEX);
+            Log.print(F(", fallback in "));
+        }
+        Log.print(delayMs);
+        Log.println(F("ms..."));
+    }
+    timerStart(relayTimer, delayMs);
+    return designated ? RELAY_QUEUED : RELAY_FALLBACK;
+}
+
+uint8_t* relayTxBuffer() {
+    return pending.busy ? NULL : pending.data;
+}
+
+void relayQueueOwn(uint8_t len, const MeshHeader& header) {
+    pending.rxDoneUs = pending.queuedUs = micros();
+    pending.queuedMs = rtcNowMs();
+    pending.len = len;
+    pending.header = header;
+    pending.rssi = 0;
+    pending.snrQ4 = 0;
+    pending.attempts = 0;
+    pending.quietServed = false;
+    pending.busy = true;
+    pending.fallback = false;
+    pending.own = true;
+    pending.preset = 0;
+    // Без relay_delay: отсрочку listen-before-talk выдерживает relayAttempt()
+    timerStart(relayTimer, 0);
+}
+
+void relayHeardRetransmission(const MeshHeader& header) {
+    if (!pending.busy || !pending.fallback || !timerActive(relayTimer)) return;
+    if (header.from != pending.header.from || header.pktId != pending.header.pktId) return;
+    if (header.relayNode != pending.header.nextHop) return;
+
+    timerStop(relayTimer);
+    pending.busy = false;
+    STAT_INC(nextHopHeard);
+    if (logEnabled<2>()) {
+        Log.println(F("Relay: Next hop retransmitted, fallback cancelled"));
+    }
+}
+
+bool relayPending() {
+    return pending.busy;
+}
+
+void relayLatencyPrint(Print& out) {
+    static const char* const NAMES[LAT_STAGE_COUNT] = { "proc", "delay", "busy", "air", "total" };
+    out.println(F("stage max_us | log2 us histogram"));
+    for (uint8_t i = 0; i < LAT_STAGE_COUNT; i++) {
+        out.print(NAMES[i]); out.print(' ');
+        out.print(latMaxUs[i]);
+        out.print(F(" |"));
+        uint8_t last = RELAY_LAT_BUCKETS;
+        while (last > 0 && latHist[i][last - 1] == 0) last--;
+        for (uint8_t b = 0; b < last; b++) {
+            out.print(' ');
+            out.print(latHist[i][b]);
+        }
+        out.println();
+    }
+}
+
+void relayLatencyReset() {
+    memset(latHist, 0, sizeof(latHist));
+    memset(latMaxUs, 0, sizeof(latMaxUs));
+}
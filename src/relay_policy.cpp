@@ -0,0 +1,212 @@
+#include "relay_policy.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <EEPROM.h>
+#include "config_storage.h"
+#include "crc32.h"
+#include "rtc_clock.h"
+
+#define POLICY_MAGIC 0x4B504F4C // "KPOL"
+
+/**
+ * Образ таблицы в EEPROM.
+ */
+struct PolicyImage {
+    uint32_t magic;
+    PolicyRule rules[POLICY_MAX_RULES];
+    uint32_t crc;         // CRC-32 всех полей выше
+};
+
+/**
+ * Счетчики правила в RAM, обнуляются при перезагрузке и изменении правила.
+ */
+struct PolicyState {
+    uint16_t hits;        // Пакетов подошло (насыщается)
+    uint16_t drops;       // Из них не ретранслировано
+    uint32_t windowMs;    // Начало окна POLICY_RATE
+    uint16_t windowCount; // Ретранслировано в текущем окне
+};
+
+static PolicyRule rules[POLICY_MAX_RULES];
+static PolicyState states[POLICY_MAX_RULES];
+
+static const char* const ACTION_NAMES[] = { "-", "relay", "drop", "delay", "rate" };
+#define ACTION_COUNT (sizeof(ACTION_NAMES) / sizeof(ACTION_NAMES[0]))
+
+void policyInit() {
+    PolicyImage img;
+    EEPROM.get(EEPROM_POLICY_ADDR, img);
+    if (img.magic != POLICY_MAGIC || img.crc != crc32(&img, offsetof(PolicyImage, crc))) {
+        memset(rules, 0, sizeof(rules));
+        return;
+    }
+    memcpy(rules, img.rules, sizeof(rules));
+}
+
+void policySave() {
+    PolicyImage img;
+    img.magic = POLICY_MAGIC;
+    memcpy(img.rules, rules, sizeof(rules));
+    img.crc = crc32(&img, offsetof(PolicyImage, crc));
+    // EEPROM.put перезаписывает только отличающиеся байты
+    EEPROM.put(EEPROM_POLICY_ADDR, img);
+}
+
+static inline void saturatingInc(uint16_t& v) {
+    if (v != 0xFFFF) v++;
+}
+
+bool policyAllowsRelay(const MeshHeader& header, MeshPortPeek& port, uint16_t& extraDelayMs) {
+    extraDelayMs = 0;
+
+    for (uint8_t i = 0; i < POLICY_MAX_RULES; i++) {
+        const PolicyRule& r = rules[i];
+        if (r.action == POLICY_NONE) continue;
+        if (!(r.match & POLICY_MATCH_ANY_CHAN) && r.chanHash != header.chanHash) continue;
+        if ((r.match & POLICY_MATCH_MQTT) && !header.viaMqtt) continue;
+        if (r.port != POLICY_PORT_ANY) {
+            int16_t p = meshPort(port);
+            uint16_t key = p < 0 ? POLICY_PORT_UNKNOWN : (uint16_t)p;
+            if (r.port != key) continue;
+        }
+
+        PolicyState& s = states[i];
+        saturatingInc(s.hits);
+        bool allow = true;
+        switch (r.action) {
+            case POLICY_DROP:
+                allow = false;
+                break;
+            case POLICY_DELAY:
+                extraDelayMs = r.param;
+                break;
+            case POLICY_RATE: {
+                uint32_t now = rtcNowMs();
+                if (now - s.windowMs >= POLICY_RATE_WINDOW_MS) {
+                    s.windowMs = now;
+                    s.windowCount = 0;
+                }
+                allow = s.windowCount < r.param;
+                if (allow) s.windowCount++;
+                break;
+            }
+            default:
+                break;
+        }
+        if (!allow) saturatingInc(s.drops);
+        return allow;
+    }
+    return true;
+}
+
+/**
+ * @brief Выделяет очередное поле через ',' из строки и сдвигает указатель.
+ */
+static char* nextField(char** s) {
+    char* field = *s;
+    if (!field) return NULL;
+    char* comma = strchr(field, ',');
+    if (comma) {
+        *comma = '\0';
+        *s = comma + 1;
+    } else {
+        *s = NULL;
+    }
+    return field;
+}
+
+static bool parseNumber(const char* s, int base, uint32_t max, uint32_t& out) {
+    char* end;
+    if (*s == '\0') return false;
+    out = strtoul(s, &end, base);
+    return *end == '\0' && out <= max;
+}
+
+bool policySet(const char* spec) {
+    char buf[32];
+    if (strlen(spec) >= sizeof(buf)) return false;
+    strcpy(buf, spec);
+    char* rest = buf;
+
+    uint32_t index;
+    char* field = nextField(&rest);
+    if (!parseNumber(field, 10, POLICY_MAX_RULES - 1, index)) return false;
+
+    PolicyRule r = {};
+    field = nextField(&rest);
+    if (!field) return false;
+    if (strcmp(field, "-") != 0) {
+        // Канал: HEX или '*', суффикс 'm' - только из MQTT
+        size_t n = strlen(field);
+        if (n > 0 && field[n - 1] == 'm') {
+            r.match |= POLICY_MATCH_MQTT;
+            field[n - 1] = '\0';
+        }
+        uint32_t value;
+        if (strcmp(field, "*") == 0) {
+            r.match |= POLICY_MATCH_ANY_CHAN;
+        } else if (parseNumber(field, 16, 0xFF, value)) {
+            r.chanHash = (uint8_t)value;
+        } else {
+            return false;
+        }
+
+        field = nextField(&rest);
+        if (!field) return false;
+        if (strcmp(field, "*") == 0) {
+            r.port = POLICY_PORT_ANY;
+        } else if (strcmp(field, "?") == 0) {
+            r.port = POLICY_PORT_UNKNOWN;
+        } else if (parseNumber(field, 10, 0x7FFF, value)) {
+            r.port = (uint16_t)value;
+        } else {
+            return false;
+        }
+
+        field = nextField(&rest);
+        if (!field) return false;
+        for (uint8_t a = POLICY_RELAY; a < ACTION_COUNT; a++) {
+            if (strcmp(field, ACTION_NAMES[a]) == 0) r.action = a;
+        }
+        if (r.action == POLICY_NONE) return false;
+
+        field = nextField(&rest);
+        bool needsParam = r.action == POLICY_DELAY || r.action == POLICY_RATE;
+        if (needsParam != (field != NULL)) return false;
+        if (field) {
+            if (!parseNumber(field, 10, 0xFFFF, value)) return false;
+            r.param = (uint16_t)value;
+        }
+    }
+    if (rest) return false;
+
+    rules[index] = r;
+    memset(&states[index], 0, sizeof(states[index]));
+    return true;
+}
+
+void policyPrint(Print& out) {
+    out.println(F("n chan port action param hits drops"));
+    for (uint8_t i = 0; i < POLICY_MAX_RULES; i++) {
+        const PolicyRule& r = rules[i];
+        if (r.action == POLICY_NONE) continue;
+        out.print(i);
+        out.print(' ');
+        if (r.match & POLICY_MATCH_ANY_CHAN) {
+            out.print('*');
+        } else {
+            out.print(F("0x"));
+            out.print(r.chanHash, HEX);
+        }
+        if (r.match & POLICY_MATCH_MQTT) out.print('m');
+        out.print(' ');
+        if (r.port == POLICY_PORT_ANY) out.print('*');
+        else if (r.port == POLICY_PORT_UNKNOWN) out.print('?');
+        else out.print(r.port);
+        out.print(' ');
+        out.print(r.action < ACTION_COUNT ? ACTION_NAMES[r.action] : ACTION_NAMES[0]);
+        out.print(' '); out.print(r.param);
+        out.print(' '); out.print(states[i].hits);
+        out.print(' '); out.println(states[i].drops);
+    }
+}
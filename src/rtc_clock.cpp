@@ -0,0 +1,44 @@
+#include "rtc_clock.h"
+#include <STM32RTC.h>
+
+#define STAMP_FRAC_BITS 10
+#define STAMP_TR_MASK (RTC_TR_HT | RTC_TR_HU | RTC_TR_MNT | RTC_TR_MNU | RTC_TR_ST | RTC_TR_SU)
+
+// Перевод SSR в 1/1024 секунды умножением: у Cortex-M0+ нет аппаратного деления
+static uint32_t predivS;
+static uint32_t fracScale;   // (1024 << 16) / (PREDIV_S + 1)
+
+void rtcClockInit() {
+    STM32RTC& rtc = STM32RTC::getInstance();
+    if (!rtc.isConfigured()) {
+        rtc.begin();
+    }
+    predivS = RTC->PRER & RTC_PRER_PREDIV_S;
+    fracScale = ((uint32_t)1 << (STAMP_FRAC_BITS + 16)) / (predivS + 1);
+}
+
+uint32_t rtcNowMs() {
+    uint32_t subSeconds = 0;
+    uint32_t epoch = STM32RTC::getInstance().getEpoch(&subSeconds);
+    return epoch * 1000 + subSeconds;
+}
+
+uint32_t rtcStamp() {
+    // Чтение SSR фиксирует теневые TR и DR до чтения DR
+    uint32_t ssr = RTC->SSR;
+    uint32_t tr = RTC->TR;
+    (void)RTC->DR;
+    // SSR считает вниз от PREDIV_S; больше него он бывает только после подстройки сдвигом
+    uint32_t frac = ssr <= predivS ? ((predivS - ssr) * fracScale) >> 16 : 0;
+    return (tr & STAMP_TR_MASK) << STAMP_FRAC_BITS | frac;
+}
+
+static inline uint8_t bcd(uint32_t v) {
+    return (v >> 4) * 10 + (v & 0x0F);
+}
+
+uint32_t rtcStampToMs(uint32_t stamp) {
+    uint32_t tr = stamp >> STAMP_FRAC_BITS;
+    uint32_t seconds = bcd((tr >> 16) & 0x3F) * 3600UL + bcd((tr >> 8) & 0x7F) * 60 + bcd(tr & 0x7F);
+    return seconds * 1000 + ((stamp & ((1 << STAMP_FRAC_BITS) - 1)) * 1000 >> STAMP_FRAC_BITS);
+}
@@ -0,0 +1,56 @@
+#include "stats.h"
+#include "packet_cache.h"
+
+RuntimeStats runtimeStats = { .evictAgeMinS = UINT32_MAX };
+
+void statsReset() {
+    memset(&runtimeStats, 0, sizeof(runtimeStats));
+    runtimeStats.evictAgeMinS = UINT32_MAX;
+}
+
+void statsEviction(uint32_t ageMs) {
+    uint32_t ageS = ageMs / 1000;
+    runtimeStats.evictAgeLastS = ageS;
+    if (ageS < runtimeStats.evictAgeMinS) runtimeStats.evictAgeMinS = ageS;
+}
+
+static void printStat(Print& out, const __FlashStringHelper* name, uint32_t value) {
+    out.print(name);
+    out.print('=');
+    out.print(value);
+    out.print(';');
+}
+
+void statsPrint(Print& out) {
+    const RuntimeStats& s = runtimeStats;
+    printStat(out, F("rx"), s.rxFrames);
+    printStat(out, F("crc"), s.rxCrcErrors);
+    printStat(out, F("err"), s.rxErrors);
+    printStat(out, F("short"), s.rxShort);
+    printStat(out, F("new"), s.rxNew);
+    printStat(out, F("dup"), s.rxDup);
+    printStat(out, F("relay"), s.relayed);
+    printStat(out, F("slotbusy"), s.relaySlotBusy);
+    printStat(out, F("chbusy"), s.relayChannelBusy);
+    printStat(out, F("pwrskip"), s.relayPowerSkip);
+    printStat(out, F("poldrop"), s.relayPolicyDrop);
+    printStat(out, F("flood"), s.relayFlood);
+    printStat(out, F("nh_heard"), s.nextHopHeard);
+    printStat(out, F("nh_fallback"), s.nextHopFallback);
+    printStat(out, F("cad"), s.cadAttempts);
+    printStat(out, F("cadbusy"), s.cadBusy);
+    printStat(out, F("lbt_restart"), s.lbtRestart);
+    printStat(out, F("airtime_ms"), s.txAirtimeMs);
+    printStat(out, F("rx_airtime_ms"), s.rxAirtimeMs);
+    printStat(out, F("tlm_tx"), s.telemetrySent);
+    printStat(out, F("wake_dio0"), s.wakeDio0);
+    printStat(out, F("wake_uart"), s.wakeUart);
+    printStat(out, F("wake_timer"), s.wakeTimer);
+    printStat(out, F("evict"), s.cacheEvictions);
+    printStat(out, F("evict_age_s"), s.evictAgeLastS);
+    printStat(out, F("evict_min_s"), s.evictAgeMinS == UINT32_MAX ? 0 : s.evictAgeMinS);
+    out.print(F("cache="));
+    out.print(getPacketCacheSize());
+    out.print('/');
+    out.println(getPacketCacheCapacity());
+}
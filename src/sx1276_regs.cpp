@@ -0,0 +1,167 @@
+#include "sx1276_regs.h"
+#include <EEPROM.h>
+#include <stddef.h>
+#include "crc32.h"
+
+void KaskaSX1276::syncModemState(const DeviceConfig& cfg) {
+    frequency = radioLibFrequency(cfg);
+    bandwidth = radioLibBandwidth(cfg);
+    spreadingFactor = cfg.radio_spreadingFactor;
+    codingRate = cfg.radio_codingRate;
+    crcEnabled = true;
+}
+
+/**
+ * @brief Отпечаток радиопараметров. Считается по полям, а не по структуре, чтобы не зависеть от padding.
+ */
+static uint32_t radioConfigFingerprint(const DeviceConfig& cfg) {
+    uint32_t crc = crc32(&cfg.radio_frequency, sizeof(cfg.radio_frequency));
+    crc = crc32Update(crc, &cfg.radio_bandwidth, sizeof(cfg.radio_bandwidth));
+    crc = crc32Update(crc, &cfg.radio_spreadingFactor, sizeof(cfg.radio_spreadingFactor));
+    crc = crc32Update(crc, &cfg.radio_codingRate, sizeof(cfg.radio_codingRate));
+    crc = crc32Update(crc, &cfg.radio_syncWord, sizeof(cfg.radio_syncWord));
+    crc = crc32Update(crc, &cfg.radio_preambleLength, sizeof(cfg.radio_preambleLength));
+    return crc;
+}
+
+/**
+ * @brief Читает из чипа регистры, входящие в образ.
+ */
+static void readImageRegs(Module* mod, RadioImage& img) {
+    mod->SPIreadRegisterBurst(SX1276_IMG_LO_ADDR, SX1276_IMG_LO_LEN, img.regsLo);
+    mod->SPIreadRegisterBurst(SX1276_IMG_MODEM_ADDR, SX1276_IMG_MODEM_LEN, img.regsModem);
+    img.paDac = mod->SPIreadRegister(SX1276_REG_PA_DAC);
+}
+
+// Регистры внутри диапазонов образа, которые меняются при работе чипа (указатели FIFO, FEI, RSSI)
+static const uint8_t VOLATILE_REGS[] = {0x0D, 0x25, 0x28, 0x29, 0x2A, 0x2C};
+
+/**
+ * @brief Сравнивает образы, игнорируя изменчивые регистры.
+ */
+static bool imageRegsMatch(RadioImage& live, const RadioImage& img) {
+    for (size_t i = 0; i < sizeof(VOLATILE_REGS); i++) {
+        uint8_t reg = VOLATILE_REGS[i];
+        if (reg < SX1276_IMG_MODEM_ADDR) {
+            live.regsLo[reg - SX1276_IMG_LO_ADDR] = img.regsLo[reg - SX1276_IMG_LO_ADDR];
+        } else {
+            live.regsModem[reg - SX1276_IMG_MODEM_ADDR] = img.regsModem[reg - SX1276_IMG_MODEM_ADDR];
+        }
+    }
+    return memcmp(live.regsLo, img.regsLo, SX1276_IMG_LO_LEN) == 0 &&
+           memcmp(live.regsModem, img.regsModem, SX1276_IMG_MODEM_LEN) == 0 &&
+           live.paDac == img.paDac;
+}
+
+bool radioImageRestore(KaskaSX1276& radio, const DeviceConfig& cfg) {
+    RadioImage img;
+    EEPROM.get(EEPROM_RADIO_IMAGE_ADDR, img);
+
+    if (img.magic != RADIO_IMAGE_MAGIC ||
+        img.crc != crc32(&img, offsetof(RadioImage, crc)) ||
+        img.configCrc != radioConfigFingerprint(cfg)) {
+        return false;
+    }
+
+    Module* mod = radio.getMod();
+    mod->init();
+
+    // Если сбросился только МК, чип уже настроен: сверяем регистры и не трогаем его
+    RadioImage live;
+    readImageRegs(mod, live);
+    bool warm = (mod->SPIreadRegister(SX1276_REG_OP_MODE) & SX1276_OP_LORA) &&
+                imageRegsMatch(live, img);
+
+    if (!warm) {
+        radio.reset();
+        if (mod->SPIreadRegister(SX1276_REG_VERSION) != SX1276_CHIP_VERSION) {
+            return false;
+        }
+        // Бит LongRangeMode переключается только в Sleep
+        mod->SPIwriteRegister(SX1276_REG_OP_MODE, SX1276_OP_LORA | SX1276_OP_SLEEP);
+        mod->SPIwriteRegister(SX1276_REG_OP_MODE, SX1276_OP_LORA | SX1276_OP_STDBY);
+        mod->SPIwriteRegisterBurst(SX1276_IMG_LO_ADDR, img.regsLo, SX1276_IMG_LO_LEN);
+        mod->SPIwriteRegisterBurst(SX1276_IMG_MODEM_ADDR, img.regsModem, SX1276_IMG_MODEM_LEN);
+        mod->SPIwriteRegister(SX1276_REG_PA_DAC, img.paDac);
+    }
+
+    radio.syncModemState(cfg);
+    return radio.startReceive() == RADIOLIB_ERR_NONE;
+}
+
+void radioImageCapture(KaskaSX1276& radio, const DeviceConfig& cfg) {
+    RadioImage img;
+    memset(&img, 0, sizeof(img));
+    img.magic = RADIO_IMAGE_MAGIC;
+    img.configCrc = radioConfigFingerprint(cfg);
+    readImageRegs(radio.getMod(), img);
+    img.crc = crc32(&img, offsetof(RadioImage, crc));
+    // EEPROM.put перезаписывает только отличающиеся байты
+    EEPROM.put(EEPROM_RADIO_IMAGE_ADDR, img);
+}
+
+int8_t sx1276PacketSnrQ4(KaskaSX1276& radio) {
+    return (int8_t)radio.getMod()->SPIreadRegister(SX1276_REG_PKT_SNR);
+}
+
+/**
+ * @brief Смещение RSSI для порта текущей частоты (даташит SX1276, 5.5.5): -157 для HF,
+ * -164 для LF. Порт определяется по RegFrfMsb, а не по конфигурации: при сканировании
+ * частота меняется. Граница лежит между диапазонами (525 и 862 МГц), хватает старшего байта.
+ */
+static int16_t rssiOffset(Module* mod) {
+    return mod->SPIreadRegister(SX1276_REG_FRF_MSB) < SX1276_FRF_MSB_HF ? -164 : -157;
+}
+
+int16_t sx1276PacketRssi(KaskaSX1276& radio) {
+    Module* mod = radio.getMod();
+    int8_t snrQ4 = (int8_t)mod->SPIreadRegister(SX1276_REG_PKT_SNR);
+    int16_t raw = mod->SPIreadRegister(SX1276_REG_PKT_RSSI);
+    int16_t offset = rssiOffset(mod);
+    // Даташит SX1276, 5.5.5: при SNR < 0 к RSSI добавляется SNR
+    if (snrQ4 < 0) {
+        return offset + raw + snrQ4 / 4;
+    }
+    return offset + (raw * 16) / 15;
+}
+
+int16_t sx1276CurrentRssi(KaskaSX1276& radio) {
+    Module* mod = radio.getMod();
+    return rssiOffset(mod) + mod->SPIreadRegister(SX1276_REG_RSSI_VALUE);
+}
+
+uint32_t sx1276RandomSeed(KaskaSX1276& radio) {
+    Module* mod = radio.getMod();
+    uint32_t seed = 0;
+    for (uint8_t i = 0; i < 32; i++) {
+        seed = (seed << 1) | (mod->SPIreadRegister(SX1276_REG_RSSI_WIDEBAND) & 0x01);
+    }
+    return seed;
+}
+
+int32_t sx1276FreqErrorHz(KaskaSX1276& radio, uint32_t bandwidthHz) {
+    uint8_t fei[3];
+    radio.getMod()->SPIreadRegisterBurst(SX1276_REG_FEI_MSB, 3, fei);
+    // 20-битное знаковое значение
+    int32_t raw = ((int32_t)(fei[0] & 0x0F) << 16) | ((int32_t)fei[1] << 8) | fei[2];
+    if (raw & 0x80000) raw -= 0x100000;
+    // Даташит SX1276, 4.1.5: Ferr = FEI * 2^24 / Fxtal * BW / 500 кГц, Fxtal = 32 МГц.
+    // 2^24 / 32e6 = 8192 / 15625
+    return (int32_t)((int64_t)raw * 8192 * bandwidthHz / (15625LL * 500000));
+}
+
+uint32_t loraTimeOnAirUs(const DeviceConfig& cfg, uint8_t len) {
+    uint8_t sf = cfg.radio_spreadingFactor;
+    uint32_t symbolUs = loraSymbolUs(sf, cfg.radio_bandwidth);
+    uint8_t ldro = symbolUs >= 16000 ? 1 : 0;
+
+    // Символы нагрузки: 8 + ceil((8*PL - 4*SF + 28 + 16*CRC) / (4*(SF - 2*DE))) * (CR + 4)
+    int32_t bits = 8 * (int32_t)len - 4 * sf + 28 + 16;
+    int32_t perSymbol = 4 * (sf - 2 * ldro);
+    uint32_t payloadSymbols = 8;
+    if (bits > 0) payloadSymbols += (bits + perSymbol - 1) / perSymbol * cfg.radio_codingRate;
+
+    // Преамбула: Npre + 4.25 символа, считается в четвертях символа
+    uint64_t quarters = (uint64_t)cfg.radio_preambleLength * 4 + 17 + payloadSymbols * 4;
+    return (uint32_t)(quarters * symbolUs / 4);
+}
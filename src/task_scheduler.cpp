@@ -0,0 +1,68 @@
+#include "task_scheduler.h"
+
+static Task tasks[TASK_MAX];
+static uint8_t taskCount = 0;
+
+TaskId taskCreate(const char* name, TaskFunc func) {
+    if (taskCount >= TASK_MAX) return TASK_INVALID;
+    Task& t = tasks[taskCount];
+    memset(&t, 0, sizeof(t));
+    t.func = func;
+    t.name = name;
+    return taskCount++;
+}
+
+void taskSignal(TaskId id) {
+    if (id >= taskCount) return;
+    // Повторный сигнал до обработки не сдвигает отметку времени
+    if (!tasks[id].signalled) {
+        tasks[id].signalUs = micros();
+        tasks[id].signalled = true;
+    }
+}
+
+bool taskTakeSignal(Task* t) {
+    noInterrupts();
+    bool was = t->signalled;
+    uint32_t since = t->signalUs;
+    t->signalled = false;
+    interrupts();
+
+    if (was) {
+        uint32_t latency = micros() - since;
+        if (latency > t->maxLatencyUs) t->maxLatencyUs = latency;
+    }
+    return was;
+}
+
+bool taskRunAll() {
+    bool ready = false;
+    for (uint8_t i = 0; i < taskCount; i++) {
+        Task& t = tasks[i];
+        uint32_t start = micros();
+        TaskState state = t.func(&t);
+        uint32_t elapsed = micros() - start;
+
+        t.runs++;
+        t.runUs += elapsed;
+        if (elapsed > t.maxRunUs) t.maxRunUs = elapsed;
+        if (state != TASK_WAITING) ready = true;
+    }
+    // Сигнал мог прийти из прерывания уже после того, как задачу опросили
+    for (uint8_t i = 0; i < taskCount && !ready; i++) {
+        ready = tasks[i].signalled;
+    }
+    return ready;
+}
+
+void taskPrintStats(Print& out) {
+    out.println(F("task runs run_us max_us lat_us"));
+    for (uint8_t i = 0; i < taskCount; i++) {
+        const Task& t = tasks[i];
+        out.print(t.name); out.print(' ');
+        out.print(t.runs); out.print(' ');
+        out.print(t.runUs); out.print(' ');
+        out.print(t.maxRunUs); out.print(' ');
+        out.println(t.maxLatencyUs);
+    }
+}
@@ -0,0 +1,189 @@
+#include "telemetry.h"
+#include "config_storage.h"
+#include "mesh_utils.h"
+#include "fixed_point.h"
+#include "crc32.h"
+#include "relay.h"
+#include "packet_cache.h"
+#include "battery_monitor.h"
+#include "power_policy.h"
+#include "stats.h"
+#include "rtc_clock.h"
+#include "timer_service.h"
+#include "task_scheduler.h"
+#include "log.h"
+
+// Номера полей meshtastic.Data и telemetry.proto
+#define DATA_PORTNUM          1
+#define DATA_PAYLOAD          2
+#define TLM_DEVICE_METRICS    2
+#define TLM_LOCAL_STATS       6
+#define DM_BATTERY_LEVEL      1
+#define DM_VOLTAGE            2
+#define DM_CHANNEL_UTIL       3
+#define DM_AIR_UTIL_TX        4
+#define DM_UPTIME             5
+#define LS_UPTIME             1
+#define LS_CHANNEL_UTIL       2
+#define LS_AIR_UTIL_TX        3
+#define LS_PACKETS_TX         4
+#define LS_PACKETS_RX         5
+#define LS_PACKETS_RX_BAD     6
+#define LS_RX_DUPE            9
+#define LS_TX_RELAY           10
+#define LS_TX_RELAY_CANCELED  11
+#define LS_TX_DROPPED         14
+
+#define TELEMETRY_MAX_LEN     255   // Длина кадра SX1276
+
+static uint32_t nodeNum;
+static TimerId tlmTimer = TIMER_INVALID;
+static TaskId tlmTaskId = TASK_INVALID;
+
+// Отметки прошлого маяка: загрузка канала считается за период между маяками
+static uint32_t lastMs;
+static uint32_t lastRxAirMs;
+static uint32_t lastTxAirMs;
+static uint64_t uptimeMs;   // rtcNowMs() переполняется через ~49 суток, поэтому копим сами
+static uint16_t beaconCount;
+
+static void telemetryWake() {
+    taskSignal(tlmTaskId);
+}
+
+/**
+ * @brief Прирост счетчика с прошлого маяка. После stats=0 счетчик меньше отметки.
+ */
+static inline uint32_t sinceLast(uint32_t value, uint32_t last) {
+    return value >= last ? value - last : value;
+}
+
+/**
+ * @brief Доля busyMs от periodMs в сотых долях процента.
+ */
+static inline uint32_t utilization(uint32_t busyMs, uint32_t periodMs) {
+    if (periodMs == 0) return 0;
+    uint64_t u = (uint64_t)busyMs * 10000 / periodMs;
+    return u > 10000 ? 10000 : (uint32_t)u;
+}
+
+static uint8_t batteryLevel(uint16_t mv) {
+    uint16_t empty = currentConfig.battery_threshold;
+    if (mv <= empty) return 0;
+    if (mv >= TELEMETRY_BATTERY_FULL_MV) return 100;
+    return (uint32_t)(mv - empty) * 100 / (TELEMETRY_BATTERY_FULL_MV - empty);
+}
+
+/**
+ * @brief Собирает маяк прямо в слоте передачи и ставит его в очередь.
+ *
+ * @return false если слот занят ретрансляцией и попытку нужно повторить
+ */
+static bool telemetrySend() {
+    // На критической ступени период пропускается: заряд важнее отчета
+    if (powerTier() == PWR_CRITICAL) return true;
+    uint8_t* buf = relayTxBuffer();
+    if (!buf) return false;
+
+    uint32_t now = rtcNowMs();
+    uint32_t periodMs = now - lastMs;
+    uint32_t rxAirMs = sinceLast(runtimeStats.rxAirtimeMs, lastRxAirMs);
+    uint32_t txAirMs = sinceLast(runtimeStats.txAirtimeMs, lastTxAirMs);
+    uptimeMs += periodMs;
+    lastMs = now;
+    lastRxAirMs = runtimeStats.rxAirtimeMs;
+    lastTxAirMs = runtimeStats.txAirtimeMs;
+    uint32_t uptimeS = uptimeMs / 1000;
+    uint32_t chUtil = fixedToFloatBits(utilization(rxAirMs + txAirMs, periodMs), 100);
+    uint32_t airUtil = fixedToFloatBits(utilization(txAirMs, periodMs), 100);
+
+    MeshHeader header = {};
+    header.dest = MESH_BROADCAST_ADDR;
+    header.from = nodeNum;
+    header.pktId = random(1, 0x7FFFFFFF);
+    header.hopLimit = header.hopStart = TELEMETRY_HOP_LIMIT;
+    header.chanHash = TELEMETRY_CHAN_HASH;
+    header.relayNode = nodeNum & 0xFF;
+    writeMeshHeader(buf, header);
+
+    // Data { portnum, payload = Telemetry { device_metrics | local_stats } }
+    uint8_t* p = buf + 16;
+    size_t rem = TELEMETRY_MAX_LEN - 16;
+    bool localStats = beaconCount & 1;
+    bool ok = pbWriteUint(&p, &rem, DATA_PORTNUM, PORTNUM_TELEMETRY);
+    uint8_t* payload = pbBeginNested(&p, &rem, DATA_PAYLOAD);
+    uint8_t* variant = pbBeginNested(&p, &rem, localStats ? TLM_LOCAL_STATS : TLM_DEVICE_METRICS);
+    const RuntimeStats& s = runtimeStats;
+    if (localStats) {
+        ok &= pbWriteUint(&p, &rem, LS_UPTIME, uptimeS);
+        ok &= pbWriteFixed32(&p, &rem, LS_CHANNEL_UTIL, chUtil);
+        ok &= pbWriteFixed32(&p, &rem, LS_AIR_UTIL_TX, airUtil);
+        ok &= pbWriteUint(&p, &rem, LS_PACKETS_TX, s.relayed + s.telemetrySent);
+        ok &= pbWriteUint(&p, &rem, LS_PACKETS_RX, s.rxFrames);
+        ok &= pbWriteUint(&p, &rem, LS_PACKETS_RX_BAD, s.rxCrcErrors + s.rxErrors);
+        ok &= pbWriteUint(&p, &rem, LS_RX_DUPE, s.rxDup);
+        ok &= pbWriteUint(&p, &rem, LS_TX_RELAY, s.relayed);
+        ok &= pbWriteUint(&p, &rem, LS_TX_RELAY_CANCELED, s.nextHopHeard);
+        ok &= pbWriteUint(&p, &rem, LS_TX_DROPPED, s.relaySlotBusy + s.relayChannelBusy);
+    } else {
+        uint16_t mv = batteryMillivolts();
+        ok &= pbWriteUint(&p, &rem, DM_BATTERY_LEVEL, batteryLevel(mv));
+        ok &= pbWriteFixed32(&p, &rem, DM_VOLTAGE, fixedToFloatBits(mv, 1000));
+        ok &= pbWriteFixed32(&p, &rem, DM_CHANNEL_UTIL, chUtil);
+        ok &= pbWriteFixed32(&p, &rem, DM_AIR_UTIL_TX, airUtil);
+        ok &= pbWriteUint(&p, &rem, DM_UPTIME, uptimeS);
+    }
+    ok = ok && pbEndNested(variant, p) && pbEndNested(payload, p);
+    // Ошибка сборки не исправится повтором: период пропускается
+    if (!ok) return true;
+
+    uint8_t len = p - buf;
+    uint8_t psk[16];
+    meshChannelKey(header, currentConfig.aes_key, psk);
+    encryptMeshtasticPayload(buf + 16, len - 16, header.from, header.pktId, psk);
+
+    // Эхо маяка от соседних ретрансляторов не уходит в эфир повторно
+    addPacketToCache(header.from, header.pktId);
+    relayQueueOwn(len, header);
+    beaconCount++;
+
+    if (logEnabled<2>()) {
+        Log.print(F("Telemetry: "));
+        Log.print(localStats ? F("local stats, ") : F("device metrics, "));
+        Log.print(len);
+        Log.println(F(" bytes"));
+    }
+    return true;
+}
+
+/**
+ * @brief Задача маяка: по таймеру собирает и отправляет пакет.
+ */
+static TaskState telemetryThread(Task* t) {
+    TASK_BEGIN(t);
+    for (;;) {
+        TASK_WAIT_SIGNAL(t);
+        if (currentConfig.telemetry_interval == 0) continue;
+        timerStart(tlmTimer, telemetrySend() ? (uint32_t)currentConfig.telemetry_interval * 60000UL
+                                             : TELEMETRY_RETRY_MS);
+    }
+    TASK_END(t);
+}
+
+void telemetryInit() {
+    uint32_t uid[3] = { HAL_GetUIDw0(), HAL_GetUIDw1(), HAL_GetUIDw2() };
+    nodeNum = crc32(uid, sizeof(uid));
+    // 0..3 зарезервированы Meshtastic
+    if (nodeNum < 4 || nodeNum == MESH_BROADCAST_ADDR) nodeNum ^= 0x80000000;
+
+    lastMs = rtcNowMs();
+    tlmTimer = timerCreate(telemetryWake);
+    tlmTaskId = taskCreate("tlm", telemetryThread);
+    if (currentConfig.telemetry_interval) {
+        timerStart(tlmTimer, (uint32_t)currentConfig.telemetry_interval * 60000UL);
+    }
+}
+
+uint32_t telemetryNodeNum() {
+    return nodeNum;
+}
@@ -0,0 +1,61 @@
+#include "timer_service.h"
+#include "rtc_clock.h"
+
+struct Timer {
+    TimerCallback callback;
+    uint32_t deadline;   // rtcNowMs()
+    uint32_t period;
+    bool active;
+};
+
+static Timer timers[TIMER_MAX];
+static uint8_t timerCount = 0;
+
+TimerId timerCreate(TimerCallback callback) {
+    if (timerCount >= TIMER_MAX) return TIMER_INVALID;
+    timers[timerCount].callback = callback;
+    timers[timerCount].active = false;
+    return timerCount++;
+}
+
+void timerStart(TimerId id, uint32_t delayMs, uint32_t periodMs) {
+    if (id >= timerCount) return;
+    timers[id].deadline = rtcNowMs() + delayMs;
+    timers[id].period = periodMs;
+    timers[id].active = true;
+}
+
+void timerStop(TimerId id) {
+    if (id < timerCount) timers[id].active = false;
+}
+
+bool timerActive(TimerId id) {
+    return id < timerCount && timers[id].active;
+}
+
+void timerRunDue(uint32_t nowMs) {
+    for (uint8_t i = 0; i < timerCount; i++) {
+        Timer& t = timers[i];
+        // Часы переполняются, поэтому сравниваем разностью
+        if (!t.active || (int32_t)(nowMs - t.deadline) < 0) continue;
+        if (t.period) {
+            t.deadline += t.period;
+            // После долгого отключения не догоняем пропущенные периоды
+            if ((int32_t)(nowMs - t.deadline) >= 0) t.deadline = nowMs + t.period;
+        } else {
+            t.active = false;
+        }
+        t.callback();
+    }
+}
+
+uint32_t timerMsUntilNext(uint32_t nowMs) {
+    uint32_t next = TIMER_NONE;
+    for (uint8_t i = 0; i < timerCount; i++) {
+        if (!timers[i].active) continue;
+        int32_t left = (int32_t)(timers[i].deadline - nowMs);
+        if (left <= 0) return 0;
+        if ((uint32_t)left < next) next = left;
+    }
+    return next;
+}
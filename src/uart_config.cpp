@@ -1,168 +1,292 @@
 #include "uart_config.h"
 #include "config_storage.h"
 #include "packet_debug.h"
+#include "packet_cache.h"
+#include "event_log.h"
+#include "task_scheduler.h"
+#include "energy_account.h"
+#include "profiler.h"
+#include "stats.h"
+#include "relay.h"
+#include "neighbor_table.h"
+#include "relay_policy.h"
+#include "fixed_point.h"
+#include "flood_guard.h"
+#include "preset_scan.h"
+#include "ram_arena.h"
+#include <stddef.h>
+
+// Представление параметра в DeviceConfig
+enum ParamType : uint8_t {
+    PT_U8,
+    PT_I8,
+    PT_HEX8,    // uint8_t, выводится как 0x..
+    PT_U16,
+    PT_U32,
+    PT_I32,
+    PT_KEY,     // 16 байт HEX, при чтении не раскрывается
+};
 
 /**
- * @brief Простой парсер float для экономии места.
- * Работает только с положительными числами.
+ * Описание параметра UART. Таблица лежит во Flash; разбор, проверка диапазона
+ * и вывод значения выполняются одним кодом для всех ключей.
+ * Поле хранит значение в единицах младшего знака (значение * 10^decimals),
+ * в тех же единицах заданы границы.
  */
-static float fast_atof(const char* s) {
-    float rez = 0, fact = 1;
-    if (*s == '-') { s++; fact = -1; };
-    for (int point_seen = 0; *s; s++) {
-        if (*s == '.') { point_seen = 1; continue; };
-        int d = *s - '0';
-        if (d >= 0 && d <= 9) {
-            if (point_seen) fact /= 10.0f;
-            rez = rez * 10.0f + (float)d;
-        };
-    };
-    return rez * fact;
+struct ConfigParam {
+    char name[5];
+    uint8_t offset;     // Смещение поля в DeviceConfig
+    uint8_t type;       // ParamType
+    uint8_t decimals;   // Знаков после точки в UART
+    int32_t min;
+    int32_t max;
+};
+
+#define PARAM(name, member, type, decimals, min, max) \
+    { name, offsetof(DeviceConfig, member), type, decimals, min, max }
+
+static const ConfigParam PARAMS[] = {
+    PARAM("freq", radio_frequency,       PT_U32,   6, 137000000, 1020000000),
+    PARAM("sf",   radio_spreadingFactor, PT_U8,    0, 7, 12),
+    PARAM("bw",   radio_bandwidth,       PT_U16,   1, 78, 5000),
+    PARAM("cr",   radio_codingRate,      PT_U8,    0, 5, 8),
+    PARAM("sw",   radio_syncWord,        PT_HEX8,  0, 0, 0xFF),
+    PARAM("pre",  radio_preambleLength,  PT_U16,   0, 6, 0xFFFF),
+    PARAM("adc",  adc_multiplier,        PT_U32,   6, 0, 1000000),
+    PARAM("batt", battery_threshold,     PT_U16,   3, 0, 5000),
+    PARAM("key",  aes_key,               PT_KEY,   0, 0, 0),
+    PARAM("log",  log_level,             PT_U8,    0, 0, 2),
+    PARAM("dlrl", relay_delay,           PT_I32,   0, -1, 60000),
+    PARAM("evs",  event_stream,          PT_U8,    0, 0, 1),
+    PARAM("cap",  capture_stream,        PT_U8,    0, 0, 1),
+    PARAM("peco", power_eco_threshold,   PT_U16,   3, 0, 5000),
+    PARAM("pcrt", power_critical_threshold, PT_U16, 3, 0, 5000),
+    PARAM("phys", power_hysteresis,      PT_U16,   3, 0, 1000),
+    PARAM("ist",  current_stop,          PT_U16,   1, 0, 0xFFFF),
+    PARAM("irun", current_run,           PT_U16,   0, 0, 0xFFFF),
+    PARAM("iuar", current_uart,          PT_U16,   0, 0, 0xFFFF),
+    PARAM("irx",  current_rx,            PT_U16,   0, 0, 0xFFFF),
+    PARAM("itx",  current_tx,            PT_U16,   0, 0, 0xFFFF),
+    PARAM("itxd", current_tx_dbm,        PT_U16,   0, 0, 0xFFFF),
+    PARAM("bcap", battery_capacity,      PT_U16,   0, 1, 0xFFFF),
+    PARAM("rid",  relay_id,              PT_HEX8,  0, 0, 0xFF),
+    PARAM("nhto", next_hop_timeout,      PT_U16,   0, 0, 60000),
+    PARAM("flsh", flood_share,           PT_U8,    0, 0, 100),
+    PARAM("scen", scan_mode,             PT_U8,    0, 0, 1),
+    PARAM("lbt",  lbt_rssi,              PT_I8,    0, -128, 0),
+    PARAM("tlm",  telemetry_interval,    PT_U16,   0, 0, 1440),
 };
 
-#define MAX_CMD_LEN 64
+#define PARAM_COUNT (sizeof(PARAMS) / sizeof(PARAMS[0]))
+
+static const int32_t POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+#define MAX_CMD_LEN 128
 static char inputBuffer[MAX_CMD_LEN];
 static uint8_t bufferIdx = 0;
+static bool inputOverflow = false;   // Строка длиннее буфера: отбрасывается целиком
 
-void processCommand(char* cmd) {
-    // Формат: <key>=<value>
+// Параметров в строке вывода cfg. Самый длинный элемент - имя (4), '=', значение
+// (до 12 знаков с точкой) и ';': 18 байт, так что строка помещается во входной буфер
+#define CFG_ITEMS_PER_LINE 7
+static_assert(CFG_ITEMS_PER_LINE * 18 < MAX_CMD_LEN, "cfg line must fit the UART input buffer");
+
+static const ConfigParam* findParam(const char* key) {
+    for (size_t i = 0; i < PARAM_COUNT; i++) {
+        if (strcmp(PARAMS[i].name, key) == 0) return &PARAMS[i];
+    }
+    return NULL;
+}
+
+/**
+ * @brief Значение параметра в единицах младшего знака.
+ */
+static int32_t paramRead(const ConfigParam& p) {
+    const uint8_t* field = (const uint8_t*)&currentConfig + p.offset;
+    switch (p.type) {
+        case PT_U16: { uint16_t v; memcpy(&v, field, sizeof(v)); return v; }
+        case PT_U32:
+        case PT_I32: { int32_t v; memcpy(&v, field, sizeof(v)); return v; }
+        case PT_I8: return (int8_t)*field;
+        default: return *field;
+    }
+}
+
+/**
+ * @brief Помещается ли значение в поле своего типа. Граница в таблице шире поля
+ * не должна приводить к усечению значения при записи.
+ */
+static bool paramFits(const ConfigParam& p, int32_t value) {
+    switch (p.type) {
+        case PT_I8: return value >= INT8_MIN && value <= INT8_MAX;
+        case PT_U16: return value >= 0 && value <= UINT16_MAX;
+        case PT_U32: return value >= 0;
+        case PT_I32: return true;
+        default: return value >= 0 && value <= UINT8_MAX;
+    }
+}
+
+static void paramWrite(const ConfigParam& p, int32_t value) {
+    uint8_t* field = (uint8_t*)&currentConfig + p.offset;
+    switch (p.type) {
+        case PT_U16: { uint16_t v = (uint16_t)value; memcpy(field, &v, sizeof(v)); break; }
+        case PT_U32:
+        case PT_I32: memcpy(field, &value, sizeof(value)); break;
+        default: *field = (uint8_t)value; break;
+    }
+}
+
+/**
+ * @brief Выводит значение параметра в виде десятичной дроби.
+ */
+static void paramPrint(const ConfigParam& p) {
+    int32_t v = paramRead(p);
+    if (p.type == PT_KEY) {
+        Serial.print(F("REDACTED"));
+    } else if (p.type == PT_HEX8) {
+        Serial.print(F("0x"));
+        Serial.print(v, HEX);
+    } else if (p.decimals) {
+        printFixedPoint(v, POW10[p.decimals], p.decimals, Serial);
+    } else {
+        Serial.print(v);
+    }
+}
+
+static bool paramSet(const ConfigParam& p, const char* val) {
+    if (p.type == PT_KEY) {
+        // Ожидаем HEX строку из 32 символов (16 байт)
+        if (strlen(val) != 32) return false;
+        uint8_t* key = (uint8_t*)&currentConfig + p.offset;
+        for (size_t i = 0; i < 16; i++) {
+            char tmp[3] = {val[i*2], val[i*2+1], '\0'};
+            key[i] = (uint8_t)strtol(tmp, NULL, 16);
+        }
+        return true;
+    }
+    int32_t value;
+    if (!parseFixed(val, p.decimals, value) || value < p.min || value > p.max || !paramFits(p, value)) return false;
+    paramWrite(p, value);
+    return true;
+}
+
+/**
+ * @brief Все параметры в формате пакетной установки (без ключа AES).
+ * По CFG_ITEMS_PER_LINE в строке, чтобы каждую можно было отправить обратно.
+ */
+static void printAllParams() {
+    uint8_t inLine = 0;
+    for (size_t i = 0; i < PARAM_COUNT; i++) {
+        if (PARAMS[i].type == PT_KEY) continue;
+        if (inLine == CFG_ITEMS_PER_LINE) {
+            Serial.println();
+            inLine = 0;
+        }
+        if (inLine) Serial.print(';');
+        inLine++;
+        Serial.print(PARAMS[i].name);
+        Serial.print('=');
+        paramPrint(PARAMS[i]);
+    }
+    Serial.println();
+}
+
+/**
+ * @brief Выполняет одну команду: установку <key>=<value>, чтение <key> или системную команду.
+ */
+static void processItem(char* cmd) {
     char* separator = strchr(cmd, '=');
-    
+
     if (separator) {
         *separator = '\0';
-        char* key = cmd;
-        char* val = separator + 1;
-
-        bool recognized = false;
-
-        if (strcmp(key, "freq") == 0) {
-            currentConfig.radio_frequency = fast_atof(val);
-            recognized = true;
-        } else if (strcmp(key, "sf") == 0) {
-            currentConfig.radio_spreadingFactor = (uint8_t)strtol(val, NULL, 10);
-            recognized = true;
-        } else if (strcmp(key, "bw") == 0) {
-            currentConfig.radio_bandwidth = fast_atof(val);
-            recognized = true;
-        } else if (strcmp(key, "cr") == 0) {
-            currentConfig.radio_codingRate = (uint8_t)strtol(val, NULL, 10);
-            recognized = true;
-        } else if (strcmp(key, "sw") == 0) {
-            currentConfig.radio_syncWord = (uint8_t)strtol(val, NULL, 0);
-            recognized = true;
-        } else if (strcmp(key, "pre") == 0) {
-            currentConfig.radio_preambleLength = (uint16_t)strtol(val, NULL, 10);
-            recognized = true;
-        } else if (strcmp(key, "adc") == 0) {
-            currentConfig.adc_multiplier = fast_atof(val);
-            recognized = true;
-        } else if (strcmp(key, "batt") == 0) {
-            currentConfig.battery_threshold = fast_atof(val);
-            recognized = true;
-        } else if (strcmp(key, "key") == 0) {
-            // Ожидаем HEX строку из 32 символов (16 байт)
-            if (strlen(val) == 32) {
-                for (size_t i = 0; i < 16; i++) {
-                    char tmp[3] = {val[i*2], val[i*2+1], '\0'};
-                    currentConfig.aes_key[i] = (uint8_t)strtol(tmp, NULL, 16);
-                }
-                recognized = true;
-            }
-        } else if (strcmp(key, "log") == 0) {
-            currentConfig.log_level = (uint8_t)strtol(val, NULL, 10);
-            recognized = true;
-        } else if (strcmp(key, "dlrl") == 0) {
-            currentConfig.relay_delay = (int32_t)strtol(val, NULL, 10);
-            recognized = true;
-        }
+        const char* val = separator + 1;
+        const ConfigParam* p = findParam(cmd);
 
-        if (recognized) {
-            Serial.print(F("Set ")); Serial.print(key);
-            Serial.print(F("="));
-            
-            // Выводим значение без использования Serial.print(float)
-            if (strcmp(key, "freq") == 0) {
-                printFixedPoint((int32_t)(currentConfig.radio_frequency * 1000), 1000, 3);
-            } else if (strcmp(key, "bw") == 0) {
-                printFixedPoint((int32_t)(currentConfig.radio_bandwidth * 10), 10, 1);
-            } else if (strcmp(key, "adc") == 0) {
-                printFixedPoint((int32_t)(currentConfig.adc_multiplier * 1000000), 1000000, 6);
-            } else if (strcmp(key, "batt") == 0) {
-                printFixedPoint((int32_t)(currentConfig.battery_threshold * 100), 100, 2);
-            } else if (strcmp(key, "key") == 0) {
-                Serial.print(F("REDACTED"));
+        if (strcmp(cmd, "stats") == 0 && strcmp(val, "0") == 0) {
+            statsReset();
+            relayLatencyReset();
+            Serial.println(F("Stats reset OK"));
+        } else if (strcmp(cmd, "pol") == 0) {
+            if (policySet(val)) {
+                Serial.println(F("Policy OK"));
             } else {
-                Serial.print(val);
+                Serial.print(F("ERROR: invalid rule "));
+                Serial.println(val);
             }
-
-            Serial.println(F(" OK"));
-        } else {
+        } else if (strcmp(cmd, "scan") == 0) {
+            if (scanSet(val)) {
+                Serial.println(F("Preset OK"));
+            } else {
+                Serial.print(F("ERROR: invalid preset "));
+                Serial.println(val);
+            }
+        } else if (!p) {
             Serial.print(F("ERROR: unknown key "));
-            Serial.println(key);
+            Serial.println(cmd);
+        } else if (!paramSet(*p, val)) {
+            Serial.print(F("ERROR: invalid value "));
+            Serial.println(cmd);
+        } else {
+            Serial.print(F("Set ")); Serial.print(cmd);
+            Serial.print(F("="));
+            paramPrint(*p);
+            Serial.println(F(" OK"));
         }
+        return;
+    }
+
+    const ConfigParam* p = findParam(cmd);
+    if (p) {
+        Serial.print(cmd); Serial.print(F("="));
+        paramPrint(*p);
+        Serial.println();
+    } else if (strcmp(cmd, "apply") == 0) {
+        Serial.println(F("Saving & Rebooting..."));
+        saveConfig(currentConfig);
+        policySave();
+        scanSave();
+        packetCacheSave();
+        delay(500);
+        NVIC_SystemReset();
+    } else if (strcmp(cmd, "dump") == 0) {
+        eventLogDump(Serial);
+    } else if (strcmp(cmd, "cfg") == 0) {
+        printAllParams();
+    } else if (strcmp(cmd, "tasks") == 0) {
+        taskPrintStats(Serial);
+    } else if (strcmp(cmd, "stats") == 0) {
+        statsPrint(Serial);
+    } else if (strcmp(cmd, "nb") == 0) {
+        neighborPrint(Serial);
+    } else if (strcmp(cmd, "pol") == 0) {
+        policyPrint(Serial);
+    } else if (strcmp(cmd, "scan") == 0) {
+        scanPrint(Serial);
+    } else if (strcmp(cmd, "flood") == 0) {
+        floodPrint(Serial);
+    } else if (strcmp(cmd, "lat") == 0) {
+        relayLatencyPrint(Serial);
+    } else if (strcmp(cmd, "mem") == 0) {
+        arenaPrint(Serial);
+    } else if (strcmp(cmd, "power") == 0) {
+        energyPrintReport(Serial);
+#ifdef ENABLE_PROFILER
+    } else if (strcmp(cmd, "prof") == 0) {
+        profPrint(Serial);
+#endif
     } else {
-        // Одиночные команды (чтение значения по ключу или системные команды)
-        bool handled = false;
-        const char* key = cmd;
-        
-        if (strcmp(key, "freq") == 0) {
-            Serial.print(key); Serial.print(F("="));
-            printFixedPoint((int32_t)(currentConfig.radio_frequency * 1000), 1000, 3);
-            handled = true;
-        } else if (strcmp(key, "sf") == 0) {
-            Serial.print(key); Serial.print(F("="));
-            Serial.print(currentConfig.radio_spreadingFactor);
-            handled = true;
-        } else if (strcmp(key, "bw") == 0) {
-            Serial.print(key); Serial.print(F("="));
-            printFixedPoint((int32_t)(currentConfig.radio_bandwidth * 10), 10, 1);
-            handled = true;
-        } else if (strcmp(key, "cr") == 0) {
-            Serial.print(key); Serial.print(F("="));
-            Serial.print(currentConfig.radio_codingRate);
-            handled = true;
-        } else if (strcmp(key, "sw") == 0) {
-            Serial.print(key); Serial.print(F("="));
-            Serial.print(currentConfig.radio_syncWord, HEX);
-            handled = true;
-        } else if (strcmp(key, "pre") == 0) {
-            Serial.print(key); Serial.print(F("="));
-            Serial.print(currentConfig.radio_preambleLength);
-            handled = true;
-        } else if (strcmp(key, "adc") == 0) {
-            Serial.print(key); Serial.print(F("="));
-            printFixedPoint((int32_t)(currentConfig.adc_multiplier * 1000000), 1000000, 6);
-            handled = true;
-        } else if (strcmp(key, "batt") == 0) {
-            Serial.print(key); Serial.print(F("="));
-            printFixedPoint((int32_t)(currentConfig.battery_threshold * 100), 100, 2);
-            handled = true;
-        } else if (strcmp(key, "key") == 0) {
-            Serial.print(key); Serial.print(F("=REDACTED"));
-            handled = true;
-        } else if (strcmp(key, "log") == 0) {
-            Serial.print(key); Serial.print(F("="));
-            Serial.print(currentConfig.log_level);
-            handled = true;
-        } else if (strcmp(key, "dlrl") == 0) {
-            Serial.print(key); Serial.print(F("="));
-            Serial.print(currentConfig.relay_delay);
-            handled = true;
-        }
+        Serial.print(F("ERROR: unknown command "));
+        Serial.println(cmd);
+    }
+}
 
-        if (handled) {
-            Serial.println();
-        } else {
-            if (strcmp(cmd, "apply") == 0) {
-                Serial.println(F("Saving & Rebooting..."));
-                saveConfig(currentConfig);
-                delay(500);
-                NVIC_SystemReset();
-            } else {
-                Serial.print(F("ERROR: unknown command "));
-                Serial.println(cmd);
-            }
-        }
+void processCommand(char* cmd) {
+    // Пакетная форма: команды через ';', выполняются по порядку
+    while (cmd) {
+        char* next = strchr(cmd, ';');
+        if (next) *next++ = '\0';
+        if (*cmd) processItem(cmd);
+        cmd = next;
     }
 }
 
@@ -170,13 +294,20 @@ void uartConfigLoop() {
     while (Serial.available()) {
         char c = Serial.read();
         if (c == '\n' || c == '\r') {
-            if (bufferIdx > 0) {
+            // Обрезанная строка не выполняется: последний элемент получил бы усеченное значение
+            if (inputOverflow) {
+                Serial.print(F("ERROR: line longer than "));
+                Serial.println(MAX_CMD_LEN - 1);
+            } else if (bufferIdx > 0) {
                 inputBuffer[bufferIdx] = '\0';
                 processCommand(inputBuffer);
-                bufferIdx = 0;
             }
+            bufferIdx = 0;
+            inputOverflow = false;
         } else if (bufferIdx < MAX_CMD_LEN - 1) {
             inputBuffer[bufferIdx++] = c;
+        } else {
+            inputOverflow = true;
         }
     }
 }
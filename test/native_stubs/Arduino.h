@@ -0,0 +1,47 @@
+#ifndef NATIVE_ARDUINO_H
+#define NATIVE_ARDUINO_H
+
+// Минимальная замена Arduino.h для тестов на ПК (env:native): только то,
+// что нужно модулям без периферии. Вывод в Serial отбрасывается.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+
+#define HEX 16
+#define DEC 10
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper*>(s))
+
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        for (size_t i = 0; i < size; i++) write(buffer[i]);
+        return size;
+    }
+    virtual void flush() {}
+
+    size_t print(const __FlashStringHelper*) { return 0; }
+    size_t print(const char*) { return 0; }
+    size_t print(char) { return 0; }
+    size_t print(long, int = DEC) { return 0; }
+    size_t print(unsigned long, int = DEC) { return 0; }
+    size_t print(int v, int base = DEC) { return print((long)v, base); }
+    size_t print(unsigned int v, int base = DEC) { return print((unsigned long)v, base); }
+    template <typename T> size_t println(T v) { return print(v); }
+    template <typename T> size_t println(T v, int base) { return print(v, base); }
+    size_t println() { return 0; }
+};
+
+class NullSerial : public Print {
+public:
+    size_t write(uint8_t) override { return 1; }
+};
+
+inline NullSerial Serial;
+
+#endif // NATIVE_ARDUINO_H
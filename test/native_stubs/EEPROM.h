@@ -0,0 +1,41 @@
+#ifndef NATIVE_EEPROM_H
+#define NATIVE_EEPROM_H
+
+#include <Arduino.h>
+
+/**
+ * Data EEPROM в RAM с эмуляцией пропадания питания: после writeBudget
+ * изменившихся байт запись прекращается, как будто контроллер сбросился.
+ */
+class EEPROMClass {
+public:
+    uint8_t data[2048] = {};
+    int32_t writeBudget = -1;   // -1 - без ограничения
+    uint32_t bytesWritten = 0;  // Изменившиеся байты, записанные с последнего обнуления
+
+    uint8_t read(int addr) { return data[addr]; }
+
+    void update(int addr, uint8_t value) {
+        if (data[addr] == value || writeBudget == 0) return;
+        if (writeBudget > 0) writeBudget--;
+        data[addr] = value;
+        bytesWritten++;
+    }
+
+    void write(int addr, uint8_t value) { update(addr, value); }
+    uint16_t length() { return sizeof(data); }
+
+    template <typename T> T& get(int addr, T& t) {
+        memcpy(&t, data + addr, sizeof(T));
+        return t;
+    }
+    template <typename T> const T& put(int addr, const T& t) {
+        const uint8_t* p = (const uint8_t*)&t;
+        for (size_t i = 0; i < sizeof(T); i++) update(addr + i, p[i]);
+        return t;
+    }
+};
+
+inline EEPROMClass EEPROM;
+
+#endif // NATIVE_EEPROM_H
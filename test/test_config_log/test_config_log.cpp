@@ -0,0 +1,106 @@
+// Журнал конфигурации при обрыве записи: pio test -e native
+//
+// Каждое сохранение повторяется с пропаданием питания после каждого записанного байта.
+// После "перезагрузки" каждое поле должно иметь либо прежнее, либо новое значение,
+// но не значение по умолчанию.
+
+#include <unity.h>
+#include <EEPROM.h>
+#include "config_storage.h"
+
+DeviceConfig currentConfig;
+
+#define SAVES 200   // Несколько проходов кольца из 8 страниц
+
+static uint8_t snapshot[sizeof(EEPROM.data)];
+
+/**
+ * @brief Конфигурация, в которой все проверяемые поля отличаются от значений по умолчанию.
+ */
+static DeviceConfig customConfig() {
+    DeviceConfig cfg = DEFAULT_CONFIG;
+    cfg.radio_frequency = 868100000;
+    cfg.radio_spreadingFactor = 9;
+    cfg.lbt_rssi = -90;
+    cfg.flood_share = 40;
+    for (uint8_t i = 0; i < sizeof(cfg.aes_key); i++) cfg.aes_key[i] = 0xA0 + i;
+    return cfg;
+}
+
+/**
+ * @brief Изменение для сохранения номер step: короткие и длинные записи вперемешку.
+ */
+static void mutate(DeviceConfig& cfg, uint16_t step) {
+    cfg.log_level = step % 3;
+    if (step % 4 == 0) cfg.relay_delay = 100 + step;
+    if (step % 7 == 0) cfg.aes_key[step % 16] ^= 0x5A;
+}
+
+static void assertOneOf(const DeviceConfig& got, const DeviceConfig& before, const DeviceConfig& after) {
+    // Поля, которые mutate() не трогает, обязаны пережить обрыв
+    TEST_ASSERT_EQUAL_UINT32(before.radio_frequency, got.radio_frequency);
+    TEST_ASSERT_EQUAL_UINT8(before.radio_spreadingFactor, got.radio_spreadingFactor);
+    TEST_ASSERT_EQUAL_INT8(before.lbt_rssi, got.lbt_rssi);
+    TEST_ASSERT_EQUAL_UINT8(before.flood_share, got.flood_share);
+
+    TEST_ASSERT_TRUE(got.log_level == before.log_level || got.log_level == after.log_level);
+    TEST_ASSERT_TRUE(got.relay_delay == before.relay_delay || got.relay_delay == after.relay_delay);
+    TEST_ASSERT_TRUE(memcmp(got.aes_key, before.aes_key, 16) == 0 || memcmp(got.aes_key, after.aes_key, 16) == 0);
+}
+
+void setUp() {
+    memset(EEPROM.data, 0, sizeof(EEPROM.data));
+    EEPROM.writeBudget = -1;
+}
+
+void tearDown() {}
+
+static void test_torn_write_at_every_byte() {
+    DeviceConfig cfg;
+    loadConfig(cfg);
+    cfg = customConfig();
+    saveConfig(cfg);
+
+    for (uint16_t step = 1; step <= SAVES; step++) {
+        DeviceConfig before;
+        TEST_ASSERT_TRUE(loadConfig(before));
+        DeviceConfig after = before;
+        mutate(after, step);
+        memcpy(snapshot, EEPROM.data, sizeof(snapshot));
+
+        // Полное сохранение: сколько байт оно меняет
+        EEPROM.bytesWritten = 0;
+        DeviceConfig tmp = after;
+        saveConfig(tmp);
+        uint32_t total = EEPROM.bytesWritten;
+        uint8_t complete[sizeof(EEPROM.data)];
+        memcpy(complete, EEPROM.data, sizeof(complete));
+
+        for (uint32_t cut = 0; cut < total; cut++) {
+            memcpy(EEPROM.data, snapshot, sizeof(snapshot));
+            loadConfig(tmp);
+            tmp = after;
+            EEPROM.writeBudget = cut;
+            saveConfig(tmp);
+            EEPROM.writeBudget = -1;
+
+            DeviceConfig got;
+            TEST_ASSERT_TRUE(loadConfig(got));
+            assertOneOf(got, before, after);
+
+            // После перезагрузки журнал продолжает работать
+            tmp = after;
+            saveConfig(tmp);
+            TEST_ASSERT_TRUE(loadConfig(got));
+            assertOneOf(got, after, after);
+        }
+
+        memcpy(EEPROM.data, complete, sizeof(complete));
+    }
+}
+
+int main() {
+    UNITY_BEGIN();
+    RUN_TEST(test_torn_write_at_every_byte);
+    return UNITY_END();
+}